@@ -12,7 +12,6 @@
 
 #ifdef USE_SDMMC
 
-static const String allowed_file_ext[SD_NUM_ALLOWED_EXT] = {".gcode", ".nc", ".txt"};
 static bool sd_is_mounted = false;
 static uint32_t _freq_hz = 20000000;
 
@@ -153,55 +152,4 @@ bool sd_card_is_present() {
     return sd_is_mounted;
 }
 
-void sd_populate_files_menu() {
-
-    std::error_code ec;
-    const std::filesystem::path fpath{base_path};
-    char file_ext[LIST_NAME_MAX_PATH];
-    char file_path[LIST_NAME_MAX_PATH];
-
-    // No display, bail
-    if (!config->_oled) {
-        return;
-    }
-
-    // Clear the file list to start
-    config->_oled->_menu->prep_for_sd_update();
-
-    // Iterate through files if no errors (i.e. SD not found or corrupt)
-    if (sd_is_mounted) {
-
-        // Iterate through the top level directory
-        auto iter = std::filesystem::recursive_directory_iterator { fpath, ec };
-        if (!ec) {
-
-            for (auto const& dir_entry : iter) {
-
-                // Get the file extension and convert to lowercase
-                strncpy(file_ext, dir_entry.path().extension().c_str(), LIST_NAME_MAX_PATH);
-                for (auto i = 0; file_ext[i]; i++) {
-                    file_ext[i] = tolower(file_ext[i]);
-                }
-
-                // Iterate through allowed file extensions
-                for (auto i = 0; i < SD_NUM_ALLOWED_EXT; i++) {
-
-                    // Found a matching extension, list file
-                    if (strcmp(file_ext, allowed_file_ext[i].c_str()) == 0) {
-
-                        // Save file name to menu
-                        std::string full_path = dir_entry.path().c_str();
-                        std::string short_path = full_path.substr(strlen(base_path));
-
-                        strncpy(file_path, short_path.c_str(), LIST_NAME_MAX_PATH);
-                        config->_oled->_menu->add_sd_file(file_path);
-                    }    
-                }
-            }
-        }
-    }
-
-    // Refresh the menu
-    config->_oled->refresh_display(true);
-}
 #endif
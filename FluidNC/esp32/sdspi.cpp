@@ -20,7 +20,6 @@
         }                                                                                                                                  \
     } while (0)
 
-static const String allowed_file_ext[SD_NUM_ALLOWED_EXT] = {".gcode", ".nc", ".txt"};
 static bool sd_is_mounted = false;
 
 static esp_err_t mount_to_vfs_fat(int max_files, sdmmc_card_t* card, uint8_t pdrv, const char* base_path) {
@@ -140,9 +139,14 @@ bool init_spi_bus(int mosi_pin, int miso_pin, int clk_pin) {
 
 // adapted from vfs_fat_sdmmc.c:esp_vfs_fat_sdmmc_mount()
 std::error_code sd_mount(int max_files) {
-    log_info("Mount_sd");
     esp_err_t err;
 
+    // Bail if already mounted
+    if (sd_is_mounted) {
+        return {};
+    }
+    log_info("Mount_sd");
+
     // mount_prepare_mem() ... minus the strdup of base_path
     // Search for a free drive slot
     BYTE pdrv = FF_DRV_NOT_USED;
@@ -242,63 +246,4 @@ bool sd_card_is_present() {
     return res;
 }
 
-void sd_populate_files_menu() {
-
-    std::error_code ec;
-    const std::filesystem::path fpath{base_path};
-    char file_ext[LIST_NAME_MAX_PATH];
-    char file_path[LIST_NAME_MAX_PATH];
-
-    // No display, bail
-    if (!config->_oled) {
-        return;
-    }
-
-    // Clear the file list to start
-    config->_oled->_menu->prep_for_sd_update();
-
-    // SD not mounted, attempt to mount
-    if (!sd_is_mounted) {
-        ec = sd_mount();
-    }
-
-    // Iterate through files if no errors (i.e. SD not found or corrupt)
-    if (!ec) {
-
-        // Iterate through the top level directory
-        auto iter = std::filesystem::recursive_directory_iterator { fpath, ec };
-        if (!ec) {
-
-            for (auto const& dir_entry : iter) {
-
-                // Get the file extension and convert to lowercase
-                strncpy(file_ext, dir_entry.path().extension().c_str(), LIST_NAME_MAX_PATH);
-                for (auto i = 0; file_ext[i]; i++) {
-                    file_ext[i] = tolower(file_ext[i]);
-                }
-
-                // Iterate through allowed file extensions
-                for (auto i = 0; i < SD_NUM_ALLOWED_EXT; i++) {
-
-                    // Found a matching extension, list file
-                    if (strcmp(file_ext, allowed_file_ext[i].c_str()) == 0) {
-
-                        // Save file name to menu
-                        std::string full_path = dir_entry.path().c_str();
-                        std::string short_path = full_path.substr(strlen(base_path));
-
-                        strncpy(file_path, short_path.c_str(), LIST_NAME_MAX_PATH);
-                        config->_oled->_menu->add_sd_file(file_path);
-                    }    
-                }
-            }
-        }
-        
-        // Unmount the SD card
-        sd_unmount();
-    }
-
-    // Refresh the menu
-    config->_oled->refresh_display(true);
-}
 #endif
@@ -1,9 +1,9 @@
 // Copyright (c) 2022 Mitch Bradley
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
-// There is no .h file to define the interface to this code.
-// It works by replacing weak methods in the TMCStepper library,
-// namely TMCStepper::read() and TMCStepper::write()
+// This code works by replacing weak methods in the TMCStepper library,
+// namely TMCStepper::read() and TMCStepper::write().  The batching
+// and snapshot interface on top of them is in Driver/tmc_spi.h
 
 // It uses low-level direct access to the SPI hardware instead of
 // trying to use the ESP-IDF spi_master() driver.  The reason for this
@@ -37,12 +37,330 @@
 
 #include "src/Config.h"
 #include "esp32/tmc_spi_support.h"
+#include "Driver/tmc_spi.h"
 #include <TMCStepper.h>  // https://github.com/teemuatlut/TMCStepper
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <cstring>
+
+namespace {
+    const size_t packetLen      = 5;
+    const int    maxChips       = 16;
+    const int    maxChainLength = 12;  // The SPI hardware buffer holds 64 bytes
+    const int    maxShadow      = 16;  // Configuration registers remembered per chip
+    const int    maxPending     = 16;  // Queued writes per chip
+
+    const uint8_t GCONF      = 0x00;  // Reading it is harmless, so it is the no-op for idle chips in a chain
+    const uint8_t TSTEP      = 0x12;
+    const uint8_t DRV_STATUS = 0x6F;
+
+    const uint8_t resetFlag = 0x01;  // In the status byte of every response
+
+    // Write-only configuration registers, whose values are simply the last
+    // ones written.  Registers like GSTAT, where a write has side effects,
+    // are always sent.
+    bool is_config(uint8_t reg) {
+        switch (reg) {
+            case 0x00:  // GCONF
+            case 0x09:  // SHORT_CONF
+            case 0x0A:  // DRV_CONF
+            case 0x0B:  // GLOBAL_SCALER
+            case 0x10:  // IHOLD_IRUN
+            case 0x11:  // TPOWERDOWN
+            case 0x13:  // TPWMTHRS
+            case 0x14:  // TCOOLTHRS
+            case 0x15:  // THIGH
+            case 0x6C:  // CHOPCONF
+            case 0x6D:  // COOLCONF
+            case 0x6E:  // DCCTRL
+            case 0x70:  // PWMCONF
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    struct Chip {
+        TMC2130Stepper* dev;
+        int             link;  // Position in the daisy chain, or 0 if it has its own CS
+
+        int      nShadow;
+        uint8_t  shadowReg[maxShadow];
+        uint32_t shadowVal[maxShadow];
+
+        int      nPending;
+        uint8_t  pendingReg[maxPending];
+        uint32_t pendingVal[maxPending];
+
+        bool     snapped;
+        uint32_t tstep;
+        uint32_t drvStatus;
+
+        bool unchanged(uint8_t reg, uint32_t data) {
+            for (int i = 0; i < nShadow; i++) {
+                if (shadowReg[i] == reg) {
+                    return shadowVal[i] == data;
+                }
+            }
+            return false;
+        }
+
+        void remember(uint8_t reg, uint32_t data) {
+            if (!is_config(reg)) {
+                return;
+            }
+            for (int i = 0; i < nShadow; i++) {
+                if (shadowReg[i] == reg) {
+                    shadowVal[i] = data;
+                    return;
+                }
+            }
+            if (nShadow < maxShadow) {
+                shadowReg[nShadow]   = reg;
+                shadowVal[nShadow++] = data;
+            }
+        }
+
+        // A later write to a queued configuration register replaces the queued value
+        bool queue(uint8_t reg, uint32_t data) {
+            if (is_config(reg)) {
+                for (int i = 0; i < nPending; i++) {
+                    if (pendingReg[i] == reg) {
+                        pendingVal[i] = data;
+                        return true;
+                    }
+                }
+            }
+            if (nPending == maxPending) {
+                return false;
+            }
+            pendingReg[nPending]   = reg;
+            pendingVal[nPending++] = data;
+            return true;
+        }
+    };
+
+    Chip chips[maxChips];
+    int  nChips      = 0;
+    int  chainLength = 0;  // Of the daisy chain; FluidNC supports one, on a shared CS pin
+
+    int          batchDepth    = 0;
+    TaskHandle_t batchOwner    = nullptr;
+    TaskHandle_t snapshotOwner = nullptr;
+
+    bool chained(const Chip& c) { return c.link > 0; }
+
+    // The chip's response is this many packets into the input, behind
+    // those of the chips further down the chain.
+    int offset(const Chip& c) { return chained(c) ? chainLength - c.link : 0; }
+
+    // The registry is filled from inside TMC2130Stepper methods, because
+    // the chain position and length are protected members.
+    Chip* find_chip(TMC2130Stepper* dev, int link, int length) {
+        for (int i = 0; i < nChips; i++) {
+            if (chips[i].dev == dev) {
+                return &chips[i];
+            }
+        }
+        if (nChips == maxChips) {
+            return nullptr;
+        }
+        if (link > 0) {
+            if (length > maxChainLength) {
+                return nullptr;  // Too long to batch; use plain register access
+            }
+            chainLength = length;
+        }
+        Chip& c = chips[nChips++];
+        memset(&c, 0, sizeof(c));
+        c.dev  = dev;
+        c.link = link > 0 ? link : 0;
+        return &c;
+    }
+
+    bool in_batch() { return batchDepth && batchOwner == xTaskGetCurrentTaskHandle(); }
+
+    void put_packet(uint8_t* p, uint8_t cmd, uint32_t data) {
+        p[0] = cmd;
+        p[1] = data >> 24;
+        p[2] = data >> 16;
+        p[3] = data >> 8;
+        p[4] = data >> 0;
+    }
+
+    uint32_t get_data(const uint8_t* p) { return (uint32_t)p[1] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 8 | p[4]; }
+
+    // Clocks one packet per chip through the chips that share dev's CS
+    void chain_transfer(TMC2130Stepper* dev, int length, uint8_t* out, uint8_t* in) {
+        int bits = length * packetLen * 8;
+        dev->switchCSpin(0);
+        tmc_spi_transfer_data(out, bits, in, in ? bits : 0);
+        dev->switchCSpin(1);
+    }
+
+    // Sends the queued writes.  Each round gives every chip in the daisy
+    // chain its next write, or a harmless read if it has none left, in a
+    // single transaction.  Drivers with their own CS pins get one
+    // transaction per write, as before, without the per-write bus setup.
+    void flush() {
+        int             rounds  = 0;
+        bool            pending = false;
+        TMC2130Stepper* chainCS = nullptr;
+        for (int i = 0; i < nChips; i++) {
+            Chip& c = chips[i];
+            pending |= c.nPending != 0;
+            if (chained(c)) {
+                chainCS = c.dev;
+                if (c.nPending > rounds) {
+                    rounds = c.nPending;
+                }
+            }
+        }
+        if (!pending) {
+            return;
+        }
+
+        tmc_spi_bus_setup();
+
+        uint8_t out[maxChainLength * packetLen];
+        for (int round = 0; round < rounds; round++) {
+            memset(out, 0, chainLength * packetLen);  // GCONF reads
+            for (int i = 0; i < nChips; i++) {
+                Chip& c = chips[i];
+                if (chained(c) && round < c.nPending) {
+                    log_verbose("TMC reg 0x" << to_hex(c.pendingReg[round]) << " write 0x" << to_hex(c.pendingVal[round]));
+                    put_packet(&out[offset(c) * packetLen], c.pendingReg[round] | 0x80, c.pendingVal[round]);
+                }
+            }
+            chain_transfer(chainCS, chainLength, out, nullptr);
+        }
+
+        for (int i = 0; i < nChips; i++) {
+            Chip& c = chips[i];
+            if (!chained(c)) {
+                for (int j = 0; j < c.nPending; j++) {
+                    log_verbose("TMC reg 0x" << to_hex(c.pendingReg[j]) << " write 0x" << to_hex(c.pendingVal[j]));
+                    put_packet(out, c.pendingReg[j] | 0x80, c.pendingVal[j]);
+                    chain_transfer(c.dev, 1, out, nullptr);
+                }
+            }
+            c.nPending = 0;
+        }
+    }
+
+    // Reads TSTEP and DRV_STATUS from every chip that shares dev's CS in
+    // three transactions: latch TSTEP, latch DRV_STATUS while TSTEP comes
+    // out, then fetch DRV_STATUS.
+    void snap(TMC2130Stepper* dev, int length, bool chain, Chip* only) {
+        uint8_t out[maxChainLength * packetLen];
+        uint8_t in[maxChainLength * packetLen];
+        size_t  bytes = length * packetLen;
+
+        memset(out, 0, bytes);
+        for (size_t p = 0; p < bytes; p += packetLen) {
+            out[p] = TSTEP;
+        }
+        chain_transfer(dev, length, out, nullptr);
+
+        for (size_t p = 0; p < bytes; p += packetLen) {
+            out[p] = DRV_STATUS;
+        }
+        chain_transfer(dev, length, out, in);
+        for (int i = 0; i < nChips; i++) {
+            Chip& c = chips[i];
+            if (chain ? chained(c) : &c == only) {
+                c.tstep = get_data(&in[offset(c) * packetLen]);
+            }
+        }
+
+        memset(out, 0, bytes);  // GCONF reads
+        chain_transfer(dev, length, out, in);
+        for (int i = 0; i < nChips; i++) {
+            Chip& c = chips[i];
+            if (chain ? chained(c) : &c == only) {
+                const uint8_t* p = &in[offset(c) * packetLen];
+                c.drvStatus      = get_data(p);
+                c.snapped        = true;
+                if (p[0] & resetFlag) {
+                    c.nShadow = 0;  // The chip has lost its configuration
+                }
+            }
+        }
+    }
+}
+
+void tmc_spi_batch_begin() {
+    if (batchDepth && batchOwner != xTaskGetCurrentTaskHandle()) {
+        return;  // Another task's batch is open; this one's writes go out directly
+    }
+    batchOwner = xTaskGetCurrentTaskHandle();
+    ++batchDepth;
+}
+
+void tmc_spi_batch_end() {
+    if (!in_batch()) {
+        return;
+    }
+    if (--batchDepth == 0) {
+        flush();
+        batchOwner = nullptr;
+    }
+}
+
+void tmc_spi_snapshot_begin() {
+    if (nChips == 0) {
+        return;
+    }
+    tmc_spi_bus_setup();
+
+    TMC2130Stepper* chainCS = nullptr;
+    for (int i = 0; i < nChips; i++) {
+        Chip& c   = chips[i];
+        c.snapped = false;
+        if (chained(c)) {
+            chainCS = c.dev;
+        } else {
+            snap(c.dev, 1, false, &c);
+        }
+    }
+    if (chainCS) {
+        snap(chainCS, chainLength, true, nullptr);
+    }
+    snapshotOwner = xTaskGetCurrentTaskHandle();
+}
+
+void tmc_spi_snapshot_end() {
+    snapshotOwner = nullptr;
+}
+
+void tmc_spi_forget(TMC2130Stepper* dev) {
+    for (int i = 0; i < nChips; i++) {
+        if (chips[i].dev == dev) {
+            chips[i].nShadow = 0;
+        }
+    }
+}
 
 // Replace the library's weak definition of TMC2130Stepper::write()
 // This is executed in the object context so it has access to class
 // data such as the CS pin that switchCSpin() uses
 void TMC2130Stepper::write(uint8_t reg, uint32_t data) {
+    Chip* chip = find_chip(this, link_index, chain_length);
+    if (chip) {
+        if (is_config(reg) && chip->unchanged(reg, data)) {
+            return;
+        }
+        chip->remember(reg, data);
+        if (in_batch()) {
+            if (chip->queue(reg, data)) {
+                return;
+            }
+            flush();
+            chip->queue(reg, data);
+            return;
+        }
+    }
+
     log_verbose("TMC reg 0x" << to_hex(reg) << " write 0x" << to_hex(data));
     tmc_spi_bus_setup();
 
@@ -53,6 +371,21 @@ void TMC2130Stepper::write(uint8_t reg, uint32_t data) {
 
 // Replace the library's weak definition of TMC2130Stepper::read()
 uint32_t TMC2130Stepper::read(uint8_t reg) {
+    Chip* chip = find_chip(this, link_index, chain_length);
+    if (chip) {
+        if (chip->snapped && snapshotOwner == xTaskGetCurrentTaskHandle()) {
+            if (reg == TSTEP) {
+                return chip->tstep;
+            }
+            if (reg == DRV_STATUS) {
+                return chip->drvStatus;
+            }
+        }
+        if (in_batch()) {
+            flush();  // So the read sees the queued writes
+        }
+    }
+
     tmc_spi_bus_setup();
 
     switchCSpin(0);
@@ -65,11 +398,10 @@ uint32_t TMC2130Stepper::read(uint8_t reg) {
     // to account for the chips in the chain after the target one.  The
     // data for those "after" chips will appear at the beginning of the input
     // buffer, with the desired data for the target chip at the end.
-    const size_t packetLen      = 5;
-    size_t       afterChips     = link_index > 0 ? chain_length - link_index : 0;
-    size_t       dummy_in_bytes = afterChips * packetLen;
-    size_t       total_bytes    = (afterChips + 1) * packetLen;
-    size_t       total_bits     = total_bytes * 8;
+    size_t afterChips     = link_index > 0 ? chain_length - link_index : 0;
+    size_t dummy_in_bytes = afterChips * packetLen;
+    size_t total_bytes    = (afterChips + 1) * packetLen;
+    size_t total_bits     = total_bytes * 8;
 
     uint8_t in[total_bytes] = { 0 };
 
@@ -88,6 +420,10 @@ uint32_t TMC2130Stepper::read(uint8_t reg) {
     data += (uint32_t)in[dummy_in_bytes + 4];
     switchCSpin(1);
 
+    if (chip && (status & resetFlag)) {
+        chip->nShadow = 0;  // The chip has lost its configuration
+    }
+
     log_verbose("TMC reg 0x" << to_hex(reg) << " read 0x" << to_hex(data) << " status 0x" << to_hex(status));
 
     return data;
@@ -8,6 +8,8 @@
 // GPIO interface
 
 void gpio_write(pinnum_t pin, bool value);
+// Sets and clears several outputs at once; bit n of each mask is GPIO n
+void gpio_write_mask(uint64_t set, uint64_t clear);
 bool gpio_read(pinnum_t pin);
 void gpio_mode(pinnum_t pin, bool input, bool output, bool pullup, bool pulldown, bool opendrain = false);
 void gpio_set_interrupt_type(pinnum_t pin, int mode);
@@ -6,9 +6,6 @@
 
 #ifndef USE_SDMMC
 
-// Definitions
-#define SD_NUM_ALLOWED_EXT  3   // Number of allowed file extensions
-
 bool sd_init_slot(uint32_t freq_hz, int cs_pin, int cd_pin = -1, int wp_pin = -1);
 void sd_unmount();
 void sd_deinit_slot();
@@ -16,6 +13,5 @@ void sd_deinit_slot();
 std::error_code sd_mount(int max_files = 1);
 
 bool sd_card_is_present();
-void sd_populate_files_menu();
 
 #endif
@@ -0,0 +1,36 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  tmc_spi.h - batched and cached access to TMC registers over SPI
+
+  TMCStepper reads and writes registers one at a time; esp32/tmc_spi.cpp
+  replaces those methods and keeps a shadow copy of every configuration
+  register it has written, so writing a value that a chip already holds
+  costs nothing.
+
+  Between tmc_spi_batch_begin() and tmc_spi_batch_end(), writes from the
+  calling task are queued instead of sent.  At the end, the queued writes
+  for a daisy chain go out together, one register per chip in each
+  transaction, so reconfiguring every motor on a chain costs about one
+  bus transaction.  A register read inside a batch sends the queued
+  writes first, so reads still see the registers as written.
+
+  Between tmc_spi_snapshot_begin() and tmc_spi_snapshot_end(), reads of
+  DRV_STATUS and TSTEP by the calling task come from values that were
+  fetched for all the drivers at once when the snapshot began.
+*/
+
+class TMC2130Stepper;
+
+void tmc_spi_batch_begin();
+void tmc_spi_batch_end();
+
+void tmc_spi_snapshot_begin();
+void tmc_spi_snapshot_end();
+
+// Drops the shadow registers for a driver, so the next writes reach the
+// chip whatever their values.  For use before (re)initializing it.
+void tmc_spi_forget(TMC2130Stepper* dev);
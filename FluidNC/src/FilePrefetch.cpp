@@ -0,0 +1,156 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "FilePrefetch.h"
+
+#include "FileStream.h"
+#include "SettingsDefinitions.h"  // sd_prefetch
+#include "Config.h"               // SUPPORT_TASK_CORE
+#include "Logging.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <atomic>
+#include <algorithm>
+
+namespace FilePrefetch {
+    struct Chunk {
+        char   data[chunkSize];
+        size_t len;
+    };
+
+    static Chunk* chunks = nullptr;
+
+    // Free-running counters; the chunk index is counter % nChunks.
+    // The task fills chunks at _head, the consumer takes them at _tail.
+    static std::atomic<uint32_t> _head;
+    static std::atomic<uint32_t> _tail;
+    static std::atomic<bool>     _eof;
+    static std::atomic<bool>     _stop;
+    static std::atomic<bool>     _reading;
+    static bool                  _taken = false;  // The consumer holds the chunk at _tail
+
+    static FileStream* volatile _file = nullptr;
+
+    static TaskHandle_t          prefetchTask = nullptr;
+    static volatile TaskHandle_t consumerTask = nullptr;
+
+    // Cumulative since boot
+    static uint32_t nJobs       = 0;
+    static uint32_t nChunksRead = 0;
+    static uint64_t nBytes      = 0;
+    static uint32_t nUnderruns  = 0;
+    static uint32_t maxReadUs   = 0;
+    static uint32_t maxWaitUs   = 0;
+
+    static void prefetch_loop(void* unused) {
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            while (true) {
+                _reading = true;
+                FileStream* file = _file;
+                if (!file || _stop || _eof || (_head - _tail) >= uint32_t(nChunks)) {
+                    _reading = false;
+                    break;
+                }
+                Chunk&  chunk = chunks[_head % nChunks];
+                int64_t start = esp_timer_get_time();
+                chunk.len     = file->read(chunk.data, chunkSize);
+                maxReadUs     = std::max(maxReadUs, uint32_t(esp_timer_get_time() - start));
+                if (chunk.len) {
+                    ++nChunksRead;
+                    nBytes += chunk.len;
+                    ++_head;
+                } else {
+                    _eof = true;
+                }
+                _reading = false;
+                TaskHandle_t consumer = consumerTask;
+                if (consumer) {
+                    xTaskNotifyGive(consumer);
+                }
+            }
+        }
+    }
+
+    bool start(FileStream* file) {
+        if (!sd_prefetch->get() || _file) {
+            return false;
+        }
+        if (!chunks) {
+            chunks = new Chunk[nChunks];
+            xTaskCreatePinnedToCore(prefetch_loop,     // task
+                                    "prefetch",        // name for task
+                                    4096,              // size of task stack
+                                    0,                 // parameters
+                                    1,                 // priority
+                                    &prefetchTask,     // task handle
+                                    SUPPORT_TASK_CORE  // core
+            );
+        }
+        _head        = 0;
+        _tail        = 0;
+        _eof         = false;
+        _stop        = false;
+        _taken       = false;
+        consumerTask = nullptr;
+        _file        = file;
+        ++nJobs;
+        xTaskNotifyGive(prefetchTask);
+        return true;
+    }
+
+    size_t take(const char*& data) {
+        if (_taken) {
+            // Give the previous chunk back to the task for refilling
+            _taken = false;
+            ++_tail;
+            xTaskNotifyGive(prefetchTask);
+        }
+        bool    filling   = _tail == 0;  // Waiting for the first chunk is not an underrun
+        int64_t waitStart = 0;
+        while (true) {
+            bool eof = _eof;  // Read before _head; _eof is only set after the last chunk is published
+            if (_head != _tail || eof) {
+                break;
+            }
+            if (!waitStart) {
+                // Ask for a notification, then check again before sleeping.
+                // The file may have been opened by another task.
+                waitStart    = esp_timer_get_time();
+                consumerTask = xTaskGetCurrentTaskHandle();
+                continue;
+            }
+            ulTaskNotifyTake(pdTRUE, 1);
+        }
+        consumerTask = nullptr;
+        if (_head == _tail) {
+            return 0;  // End of file
+        }
+        if (waitStart && !filling) {
+            ++nUnderruns;
+            maxWaitUs = std::max(maxWaitUs, uint32_t(esp_timer_get_time() - waitStart));
+        }
+        Chunk& chunk = chunks[_tail % nChunks];
+        data         = chunk.data;
+        _taken       = true;
+        return chunk.len;
+    }
+
+    void stop() {
+        _stop = true;
+        while (_reading) {
+            vTaskDelay(1);  // Let an in-progress read finish before the file is closed
+        }
+        _file        = nullptr;
+        consumerTask = nullptr;
+    }
+
+    void report_stats(Channel& out) {
+        log_to(out,
+               "[PREFETCH:",
+               "jobs=" << nJobs << " chunks=" << nChunksRead << " bytes=" << nBytes << " underruns=" << nUnderruns
+                       << " maxRead=" << maxReadUs << "us maxWait=" << maxWaitUs << "us");
+    }
+}
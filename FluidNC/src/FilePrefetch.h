@@ -0,0 +1,43 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  FilePrefetch.h - reads a running file job ahead of the GCode parser
+
+  A background task, pinned to SUPPORT_TASK_CORE, keeps a small ring of
+  file chunks filled so that the polling task takes lines from memory and
+  a slow SD access (cluster allocation, wear leveling) does not stall line
+  delivery to the planner.  One file can be prefetched at a time; other
+  files fall back to synchronous reads.
+
+  An underrun is counted whenever the consumer finds the ring empty before
+  the end of the file and has to wait for the card.  Waiting for the first
+  chunk of a job is not counted.  The task only notifies the consumer while
+  it is waiting.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+class FileStream;
+class Channel;
+
+namespace FilePrefetch {
+    static const size_t chunkSize = 4096;
+    static const int    nChunks   = 4;
+
+    // Starts reading file in the background.  Returns false if prefetching
+    // is disabled or another file already owns the prefetcher.
+    bool start(FileStream* file);
+
+    // Returns the next chunk of the file, blocking if it has not been read
+    // yet, or 0 at end of file.  The data remains valid until the next call.
+    size_t take(const char*& data);
+
+    // Stops the background reads; must be called before the file is closed
+    void stop();
+
+    void report_stats(Channel& out);
+}
@@ -3,6 +3,7 @@
 
 #include "FileStream.h"
 #include "Machine/MachineConfig.h"  // config->
+#include "SDIndex.h"
 
 std::string FileStream::path() {
     return _fpath.c_str();
@@ -56,7 +57,8 @@ void FileStream::setup(const char* mode) {
         log_verbose("Cannot " << (opening ? "open" : "create") << " file " << _fpath.c_str());
         throw opening ? Error::FsFailedOpenFile : Error::FsFailedCreateFile;
     }
-    _size = stdfs::file_size(_fpath);
+    _size    = stdfs::file_size(_fpath);
+    _writing = *mode == 'w' || *mode == 'a';
 }
 
 FileStream::FileStream(const char* filename, const char* mode, const char* fs) : Channel("file"), _fpath(filename, fs) {
@@ -70,4 +72,7 @@ FileStream::FileStream(FluidPath fpath, const char* mode) : Channel("file") {
 
 FileStream::~FileStream() {
     fclose(_fd);
+    if (_writing) {
+        sdIndex.added(_fpath);
+    }
 }
@@ -21,6 +21,7 @@ class FileStream : public Channel {
     FluidPath _fpath;  // Keeps the volume mounted while the file is in use
     FILE*     _fd;
     size_t    _size;
+    bool      _writing = false;  // Tell the SD index about the file when it is closed
 
     void setup(const char* mode);
 
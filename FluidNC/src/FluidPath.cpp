@@ -10,6 +10,7 @@
 #include "Config.h"
 #include "Error.h"
 #include "HashFS.h"
+#include "Machine/MachineConfig.h"  // config->_sdCard
 
 int FluidPath::_refcnt = 0;
 
@@ -19,7 +20,7 @@ FluidPath::FluidPath(const char* name, const char* fs, std::error_code* ecptr) :
 
     if (_isSD) {
         if (_refcnt == 0) {
-            std::error_code ec = sd_mount();
+            std::error_code ec = config && config->_sdCard ? config->_sdCard->mount() : sd_mount();
             if (ec) {
                 if (ecptr) {
                     *ecptr = ec;
@@ -70,6 +71,8 @@ FluidPath& FluidPath::operator=(FluidPath&& o) {
 FluidPath::~FluidPath() {
     // log_debug("~ refcnt " << _isSD << " " << _refcnt);
     if (_isSD && (_refcnt && --_refcnt == 0)) {
-        sd_populate_files_menu();
+        if (config && config->_sdCard) {
+            config->_sdCard->release();
+        }
     }
 }
@@ -135,16 +135,30 @@ static void gc_wco_changed() {
     allChannels.notifyWco();
 }
 
+static Error gc_execute_block(char* line, const uint8_t* tokens, size_t n_tokens);
+
 // Executes one line of NUL-terminated G-Code.
 // The line may contain whitespace and comments, which are first removed,
 // and lower case characters, which are converted to upper case.
-// In this function, all units and positions are converted and
-// exported to internal functions in terms of (mm, mm/min) and absolute machine
-// coordinates, respectively.
+// A line that begins with TOKENIZED_LINE holds words that were parsed
+// ahead of time, which are executed without any text processing.
 Error gc_execute_line(char* line) {
+    if (line[0] == TOKENIZED_LINE) {
+        return gc_execute_block(nullptr, reinterpret_cast<const uint8_t*>(line + 2), uint8_t(line[1]));
+    }
+
     // Step 0 - remove whitespace and comments and convert to upper case
     collapseGCode(line);
 
+    return gc_execute_block(line, nullptr, 0);
+}
+
+// Executes one block, given either as collapsed text or as n_tokens packed
+// letter/value words.  In this function, all units and positions are
+// converted and exported to internal functions in terms of (mm, mm/min)
+// and absolute machine coordinates, respectively.
+static Error gc_execute_block(char* line, const uint8_t* tokens, size_t n_tokens) {
+
     /* -------------------------------------------------------------------------------------
        STEP 1: Initialize parser block struct and copy current g-code state modes. The parser
        updates these modes and commands as the block line is parser and will only be used and
@@ -178,7 +192,7 @@ Error gc_execute_line(char* line) {
     uint8_t pValue;                  // Integer value of P word
 
     // Determine if the line is a jogging motion or a normal g-code block.
-    if (line[0] == '$') {  // NOTE: `$J=` already parsed when passed to this function.
+    if (line && line[0] == '$') {  // NOTE: `$J=` already parsed when passed to this function.
         // Set G1 and G94 enforced modes to ensure accurate error checks.
         jogMotion                = true;
         gc_block.modal.motion    = Motion::Linear;
@@ -199,17 +213,25 @@ Error gc_execute_line(char* line) {
     char       letter;
     float      value;
     uint8_t    int_value = 0;
-    uint16_t   mantissa  = 0;
-    char_counter         = jogMotion ? 3 : 0;  // Start parsing after `$J=` if jogging
-    while (line[char_counter] != 0) {          // Loop until no more g-code words in line.
-        // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
-        letter = line[char_counter];
-        if ((letter < 'A') || (letter > 'Z')) {
-            FAIL(Error::ExpectedCommandLetter);  // [Expected word letter]
-        }
-        char_counter++;
-        if (!read_float(line, &char_counter, &value)) {
-            FAIL(Error::BadNumberFormat);  // [Expected word value]
+    uint16_t   mantissa    = 0;
+    size_t     token_index = 0;
+    char_counter           = jogMotion ? 3 : 0;  // Start parsing after `$J=` if jogging
+    while (tokens ? token_index < n_tokens : line[char_counter] != 0) {  // Loop until no more g-code words in line.
+        if (tokens) {
+            // Pre-tokenized words were checked when they were generated
+            const uint8_t* token = tokens + token_index++ * TOKENIZED_WORD_SIZE;
+            letter               = char(token[0]);
+            memcpy(&value, token + 1, sizeof(value));
+        } else {
+            // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
+            letter = line[char_counter];
+            if ((letter < 'A') || (letter > 'Z')) {
+                FAIL(Error::ExpectedCommandLetter);  // [Expected word letter]
+            }
+            char_counter++;
+            if (!read_float(line, &char_counter, &value)) {
+                FAIL(Error::BadNumberFormat);  // [Expected word value]
+            }
         }
         // Convert values to smaller uint8 significand and mantissa values for parsing this word.
         // NOTE: Mantissa is multiplied by 100 to catch non-integer command values. This is more
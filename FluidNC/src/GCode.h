@@ -10,6 +10,7 @@
 #include "SpindleDatatypes.h"
 
 #include <cstdint>
+#include <cstddef>
 
 enum class Override : uint8_t {
     ParkingMotion = 0,  // M56 (Default: Must be zero)
@@ -303,6 +304,16 @@ enum class AxisCommand : uint8_t {
 // Initialize the parser
 void gc_init();
 
+// A line that begins with this byte is pre-tokenized rather than text:
+// the next byte is the number of words, followed by that many words, each
+// a letter byte and a little-endian float.  See TokenizedFile.h.
+const char   TOKENIZED_LINE      = '\x01';
+const size_t TOKENIZED_WORD_SIZE = 1 + sizeof(float);
+
+// Edit a GCode line in-place, removing whitespace and comments and
+// converting to uppercase
+void collapseGCode(char* line);
+
 // Execute one block of rs275/ngc/g-code
 Error gc_execute_line(char* line);
 
@@ -1,14 +1,36 @@
 #include "HashFS.h"
 #include "FileStream.h"
 
+#include <esp32-hal.h>  // millis()
 #include <mbedtls/md.h>
+#include <sstream>
 
-std::map<std::string, std::string> HashFS::localFsHashes;
+std::map<std::string, HashFS::Entry> HashFS::localFsHashes;
+std::mutex                           HashFS::_mutex;
+bool                                 HashFS::_dirty     = false;
+uint32_t                             HashFS::_changedAt = 0;
+
+// How long the hashes must stay unchanged before poll() saves them
+static const uint32_t saveDelayMs = 2000;
+
+const char* HashFS::sidecarName = ".hashes";
 
 static char hexNibble(int i) {
     return "0123456789ABCDEF"[i & 0xf];
 }
 
+static std::string hashString(const uint8_t sha[32]) {
+    std::string str;
+    str = '"';
+    for (int i = 0; i < 32; i++) {
+        uint8_t b = sha[i];
+        str += hexNibble(b >> 4);
+        str += hexNibble(b);
+    }
+    str += '"';
+    return str;
+}
+
 static Error hashFile(const std::filesystem::path& ipath, std::string& str) {  // No ESP command
     mbedtls_md_context_t ctx;
 
@@ -32,20 +54,72 @@ static Error hashFile(const std::filesystem::path& ipath, std::string& str) {  /
         return Error::FsFailedOpenFile;
     }
 
-    str = '"';
-    for (int i = 0; i < 32; i++) {
-        uint8_t b = shaResult[i];
-        str += hexNibble(b >> 4);
-        str += hexNibble(b);
+    str = hashString(shaResult);
+    return Error::Ok;
+}
+
+// Gets the size and modification time that validate a saved hash
+static bool fileKey(const std::filesystem::path& path, uint32_t& size, int64_t& mtime) {
+    std::error_code ec;
+    auto            fsize = stdfs::file_size(path, ec);
+    if (ec) {
+        return false;
     }
-    str += '"';
+    auto ftime = stdfs::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    size  = fsize;
+    mtime = std::chrono::duration_cast<std::chrono::seconds>(ftime.time_since_epoch()).count();
+    return true;
+}
 
-    return Error::Ok;
+void HashFS::changed() {
+    _dirty     = true;
+    _changedAt = millis();
+}
+
+void HashFS::forget(const std::filesystem::path& path) {
+    if (localFsHashes.erase(path.filename())) {
+        log_debug("Deleting hash for " << path.filename());
+        changed();
+    }
+}
+
+// The file changed; its hash is computed when it is next requested
+void HashFS::update(const std::filesystem::path& path) {
+    if (file_is_hashed(path)) {
+        Entry entry;
+        if (!fileKey(path, entry.size, entry.mtime)) {
+            forget(path);
+        } else {
+            localFsHashes[path.filename()] = entry;
+            changed();
+        }
+    }
 }
 
 void HashFS::delete_file(const std::filesystem::path& path) {
-    localFsHashes.erase(path.filename());
-    log_debug("Deleting hash for " << path.filename());
+    std::lock_guard<std::mutex> lock(_mutex);
+    forget(path);
+}
+
+void HashFS::rename_file(const std::filesystem::path& from, const std::filesystem::path& to) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!file_is_hashed(from)) {
+        update(to);
+        return;
+    }
+    auto it = localFsHashes.find(from.filename());
+    if (it == localFsHashes.end() || !file_is_hashed(to)) {
+        forget(from);
+        update(to);
+        return;
+    }
+    Entry entry = it->second;
+    localFsHashes.erase(it);
+    localFsHashes[to.filename()] = entry;
+    changed();
 }
 
 bool HashFS::file_is_hashed(const std::filesystem::path& path) {
@@ -59,23 +133,72 @@ bool HashFS::file_is_hashed(const std::filesystem::path& path) {
     if (count != 3) {
         return false;
     }
+    if (path.filename() == sidecarName) {
+        return false;
+    }
     auto fsname = *++path.begin();
     return fsname == "littlefs" || fsname == "spiffs" || fsname == "localfs";
 }
 
 void HashFS::rehash_file(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    update(path);
+}
+
+void HashFS::set_hash(const std::filesystem::path& path, const uint8_t sha[32]) {
     if (file_is_hashed(path)) {
-        std::string hash;
-        if (hashFile(path, hash) != Error::Ok) {
-            delete_file(path);
-        } else {
-            localFsHashes[path.filename()] = hash;
-            log_debug(path.filename() << " hash " << hash);
+        std::lock_guard<std::mutex> lock(_mutex);
+        Entry                       entry;
+        if (!fileKey(path, entry.size, entry.mtime)) {
+            forget(path);
+            return;
         }
+        entry.hash                     = hashString(sha);
+        localFsHashes[path.filename()] = entry;
+        log_debug(path.filename() << " hash " << entry.hash);
+        changed();
     }
 }
 
+// Writes the hashes to the sidecar file, one "name size mtime hash" line
+// per file.  The file is replaced by a rename so a crash cannot leave it
+// half written.
+void HashFS::save() {
+    _dirty = false;
+
+    std::error_code ec;
+    FluidPath       lfspath { "", localfsName, ec };
+    if (ec) {
+        return;
+    }
+    std::ostringstream s;
+    for (const auto& [name, entry] : localFsHashes) {
+        if (entry.hash.length()) {
+            s << name << '\t' << entry.size << '\t' << entry.mtime << '\t' << entry.hash << '\n';
+        }
+    }
+    std::string contents = s.str();
+
+    std::filesystem::path sidecar = lfspath / sidecarName;
+    std::filesystem::path temp    = sidecar;
+    temp += ".tmp";
+    try {
+        FileStream out { temp, "w" };
+        if (out.write((const uint8_t*)contents.c_str(), contents.length()) != contents.length()) {
+            throw Error::FsFailedCreateFile;
+        }
+    } catch (const Error err) {
+        log_debug("Cannot save hashes");
+        stdfs::remove(temp, ec);
+        return;
+    }
+    stdfs::rename(temp, sidecar, ec);
+}
+
+// Loads the saved hashes, keeping those whose files are unchanged.
+// Nothing is hashed here, so boot time does not depend on the files.
 void HashFS::hash_all() {
+    std::lock_guard<std::mutex> lock(_mutex);
     localFsHashes.clear();
 
     std::error_code ec;
@@ -84,24 +207,100 @@ void HashFS::hash_all() {
         return;
     }
 
+    std::map<std::string, Entry> saved;
+    try {
+        FileStream  in { lfspath / sidecarName, "r" };
+        std::string contents(in.size(), '\0');
+        contents.resize(in.read(&contents[0], contents.length()));
+
+        std::istringstream lines(contents);
+        std::string        line;
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            std::string        name;
+            Entry              entry;
+            if (std::getline(fields, name, '\t') && fields >> entry.size >> entry.mtime >> entry.hash) {
+                saved[name] = entry;
+            }
+        }
+    } catch (const Error err) {
+        log_debug("No saved hashes");
+    }
+
     auto iter = stdfs::directory_iterator { lfspath, ec };
     if (ec) {
         log_error(lfspath << " " << ec.message());
         return;
     }
+    size_t reused = 0;
     for (auto const& dir_entry : iter) {
-        if (!dir_entry.is_directory()) {
-            rehash_file(dir_entry);
+        const std::filesystem::path& path = dir_entry.path();
+        if (dir_entry.is_directory() || !file_is_hashed(path)) {
+            continue;
+        }
+        Entry entry;
+        if (!fileKey(path, entry.size, entry.mtime)) {
+            continue;
+        }
+        auto it = saved.find(path.filename());
+        if (it != saved.end() && it->second.size == entry.size && it->second.mtime == entry.mtime) {
+            entry.hash = it->second.hash;
+            ++reused;
         }
+        localFsHashes[path.filename()] = entry;
+    }
+    log_debug("Reused " << reused << " of " << localFsHashes.size() << " file hashes");
+
+    // Drop the hashes of files that changed or went away
+    if (reused != saved.size()) {
+        changed();
     }
 }
+
+// The file is hashed without holding the lock, so the entry is only
+// filled in if the file did not change meanwhile
 std::string HashFS::hash(const std::filesystem::path& path) {
-    if (file_is_hashed(path)) {
-        std::map<std::string, std::string>::iterator it;
-        it = localFsHashes.find(path.filename());
-        if (it != localFsHashes.end()) {
-            return it->second;
+    if (!file_is_hashed(path)) {
+        return std::string();
+    }
+    Entry key;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto                        it = localFsHashes.find(path.filename());
+        if (it == localFsHashes.end()) {
+            return std::string();
         }
+        if (it->second.hash.length()) {
+            return it->second.hash;
+        }
+        key = it->second;
+    }
+
+    std::string str;
+    Error       err = hashFile(path, str);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (err != Error::Ok) {
+        forget(path);
+        return std::string();
+    }
+    auto it = localFsHashes.find(path.filename());
+    if (it != localFsHashes.end() && it->second.size == key.size && it->second.mtime == key.mtime && !it->second.hash.length()) {
+        it->second.hash = str;
+        log_debug(path.filename() << " hash " << str);
+        changed();
     }
-    return std::string();
+    return str;
+}
+
+void HashFS::poll() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_dirty && (millis() - _changedAt) >= saveDelayMs) {
+        save();
+    }
+}
+
+std::map<std::string, HashFS::Entry> HashFS::entries() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return localFsHashes;
 }
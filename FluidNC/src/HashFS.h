@@ -1,17 +1,46 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <map>
 #include <filesystem>
+#include <mutex>
 
+// Hashes of the files in the root of the local filesystem, used as HTTP
+// ETags.  The hashes are saved in a sidecar file with the size and time
+// of each file, so at boot only the files that changed lose their hash.
+// A missing hash is computed when the file is first requested.  Changes
+// are saved by poll() once they stop arriving, so hashing the files of a
+// page load writes the sidecar once.  The web server and the settings
+// commands run in different tasks, so the hashes are guarded by a mutex.
 class HashFS {
 public:
-    static std::map<std::string, std::string> localFsHashes;
-
+    struct Entry {
+        std::string hash;  // Empty until computed
+        uint32_t    size;
+        int64_t     mtime;
+    };
     static bool        file_is_hashed(const std::filesystem::path& path);
     static void        delete_file(const std::filesystem::path& path);
+    static void        rename_file(const std::filesystem::path& from, const std::filesystem::path& to);
     static void        rehash_file(const std::filesystem::path& path);
+    static void        set_hash(const std::filesystem::path& path, const uint8_t sha[32]);  // Computed while writing the file
     static void        hash_all();
     static std::string hash(const std::filesystem::path& path);
+    static void        poll();  // Saves the changes when they are settled
+
+    static std::map<std::string, Entry> entries();  // A copy, for listing
+
+    static const char* sidecarName;
 
 private:
+    static std::map<std::string, Entry> localFsHashes;
+    static std::mutex                   _mutex;
+    static bool                         _dirty;
+    static uint32_t                     _changedAt;  // millis() of the last unsaved change
+
+    // These expect _mutex to be held
+    static void forget(const std::filesystem::path& path);
+    static void update(const std::filesystem::path& path);
+    static void changed();
+    static void save();
 };
@@ -15,6 +15,7 @@ uint8_t i2s_out_read(pinnum_t pin) {
     return 0;
 }
 void i2s_out_write(pinnum_t pin, uint8_t val) {}
+void i2s_out_write_mask(uint32_t set, uint32_t clear) {}
 void i2s_out_push_sample(uint32_t usec) {}
 void i2s_out_push() {}
 void i2s_out_delay() {}
@@ -558,6 +559,15 @@ void IRAM_ATTR i2s_out_write(pinnum_t pin, uint8_t val) {
     }
 }
 
+void IRAM_ATTR i2s_out_write_mask(uint32_t set, uint32_t clear) {
+    if (set) {
+        ATOMIC_FETCH_OR(&i2s_out_port_data, set);
+    }
+    if (clear) {
+        ATOMIC_FETCH_AND(&i2s_out_port_data, ~clear);
+    }
+}
+
 uint8_t i2s_out_read(pinnum_t pin) {
     uint32_t port_data = ATOMIC_LOAD(&i2s_out_port_data);
     return (!!(port_data & bitnum_to_mask(pin)));
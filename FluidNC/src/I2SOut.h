@@ -92,6 +92,12 @@ void i2s_out_push();
 */
 void i2s_out_write(pinnum_t pin, uint8_t val);
 
+/*
+   Set and clear several pins in the expanded pin state at once
+   set, clear: masks with bit n for expanded pin No. n
+*/
+void i2s_out_write_mask(uint32_t set, uint32_t clear);
+
 /*
     Set current pin state to the I2S bitstream buffer
     (This call will generate a future I2S_OUT_USEC_PER_PULSE μs x N bitstream)
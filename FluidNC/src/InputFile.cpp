@@ -4,11 +4,60 @@
 #include "InputFile.h"
 
 #include "Report.h"
+#include "LineBuffer.h"    // format_fixed()
+#include "FilePrefetch.h"  // FilePrefetch::start()
+#include "TokenizedFile.h"
+
+#include <cstring>
+#include <algorithm>
+
+InputFile* InputFile::_progressFile = nullptr;
+std::mutex InputFile::_progressMutex;
 
 InputFile::InputFile(const char* defaultFs, const char* path, WebUI::AuthenticationLevel auth_level, Channel& out) :
-    FileStream(path, "r", defaultFs), _auth_level(auth_level), _out(out), _line_num(0)  {
+    FileStream(path, "r", defaultFs), _prefetching(FilePrefetch::start(this)), _pathName(this->path()), _auth_level(auth_level),
+    _out(out), _line_num(0) {
+    if (!_prefetching) {
+        _buffer = new char[blockSize];
+    }
     log_info("Run file opened");  // Used by OLED for elapsed time
 }
+
+// Gets the next block of the file.  Returns false at end of file.
+bool InputFile::fill() {
+    _blockPos = 0;
+    if (_prefetching) {
+        _blockLen = FilePrefetch::take(_block);
+    } else {
+        _blockLen = read(_buffer, blockSize);
+        _block    = _buffer;
+    }
+    return _blockLen != 0;
+}
+
+InputFile* InputFile::open(const char* defaultFs, const char* path, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (TokenizedFile::is_tokenized(path)) {
+        return new TokenizedFile(defaultFs, path, auth_level, out);
+    }
+    return new InputFile(defaultFs, path, auth_level, out);
+}
+
+bool InputFile::read_bytes(void* dst, size_t len) {
+    char* out = static_cast<char*>(dst);
+    while (len) {
+        if (_blockPos == _blockLen && !fill()) {
+            return false;
+        }
+        size_t n = std::min(len, _blockLen - _blockPos);
+        memcpy(out, _block + _blockPos, n);
+        out += n;
+        len -= n;
+        _blockPos += n;
+        _offset += n;
+    }
+    return true;
+}
+
 /*
   Read a line from the file
   Returns Error::Ok if a line was read, even if the line was empty.
@@ -17,27 +66,69 @@ InputFile::InputFile(const char* defaultFs, const char* path, WebUI::Authenticat
 */
 Error InputFile::readLine(char* line, int maxlen) {
     ++_line_num;
-    int len = 0;
-    int c;
-    while ((c = read()) >= 0) {
-        if (len >= maxlen) {
-            return Error::LineLengthExceeded;
+    size_t len = 0;
+    while (true) {
+        if (_blockPos == _blockLen && !fill()) {
+            line[len] = '\0';
+            return len ? Error::Ok : Error::Eof;
         }
-        if (c == '\r') {
-            continue;
+        const char* start   = _block + _blockPos;
+        size_t      avail   = _blockLen - _blockPos;
+        const char* newline = static_cast<const char*>(memchr(start, '\n', avail));
+        size_t      n       = newline ? newline - start : avail;
+
+        // Copy the piece of the line that is in this block, dropping carriage returns
+        const char* cr = static_cast<const char*>(memchr(start, '\r', n));
+        if (!cr && len + n <= size_t(maxlen)) {
+            memcpy(line + len, start, n);
+            len += n;
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                if (start[i] == '\r') {
+                    continue;
+                }
+                if (len >= size_t(maxlen)) {
+                    _blockPos += i;
+                    _offset += i;
+                    return Error::LineLengthExceeded;
+                }
+                line[len++] = start[i];
+            }
         }
-        if (c == '\n') {
-            break;
+        _blockPos += n;
+        _offset += n;
+
+        if (newline) {
+            ++_blockPos;
+            ++_offset;
+            line[len] = '\0';
+            return Error::Ok;
         }
-        line[len++] = c;
     }
-    line[len] = '\0';
-    return len || c >= 0 ? Error::Ok : Error::Eof;
 }
 
 // return a percentage complete 50.5 = 50.5%
 float InputFile::percent_complete() {
-    return (float)position() / (float)size() * 100.0f;
+    return size() ? (float)_offset / (float)size() * 100.0f : 100.0f;
+}
+
+void InputFile::set_progress_file(InputFile* file) {
+    if (_progressFile != file) {  // Only the polling task changes it
+        std::lock_guard<std::mutex> lock(_progressMutex);
+        _progressFile = file;
+    }
+}
+
+void InputFile::report_progress(Print& out) {
+    std::lock_guard<std::mutex> lock(_progressMutex);  // Keeps the file from being deleted
+    InputFile*                  file = _progressFile;
+    if (file) {
+        char percent[24];
+        out.print("|SD:");
+        out.write((const uint8_t*)percent, format_fixed(percent, file->percent_complete(), 2));
+        out.write(',');
+        out.print(file->_pathName.c_str());
+    }
 }
 
 void InputFile::ack(Error status) {
@@ -54,11 +145,6 @@ void InputFile::ack(Error status) {
     _readyNext = true;
 }
 
-std::string InputFile::_progress = "";
-
-#include <sstream>
-#include <iomanip>
-
 Channel* InputFile::pollLine(char* line) {
     // File input never returns realtime characters, so we do nothing
     // if line is null.
@@ -66,20 +152,17 @@ Channel* InputFile::pollLine(char* line) {
         return nullptr;
     }
     switch (auto err = readLine(line, Channel::maxLine)) {
-        case Error::Ok: {
-            std::ostringstream s;
-            s << "SD:" << std::fixed << std::setprecision(2) << percent_complete() << "," << path().c_str();
-            _progress = s.str();
-        }
+        case Error::Ok:
+            set_progress_file(this);
             return &allChannels;
         case Error::Eof:
-            _progress = "";
+            set_progress_file(nullptr);
             _notifyf("File job done", "%s file job succeeded", path());
             log_msg(path() << " file job succeeded");
             allChannels.kill(this);
             return nullptr;
         default:
-            _progress = "";
+            set_progress_file(nullptr);
             log_error(static_cast<int>(err) << " (" << errorString(err) << ") in " << path() << " at line " << getLineNumber());
             allChannels.kill(this);
             return nullptr;
@@ -94,6 +177,12 @@ void InputFile::stopJob() {
 }
 
 InputFile::~InputFile() {
-    _progress = "";
+    if (_progressFile == this) {
+        set_progress_file(nullptr);
+    }
+    if (_prefetching) {
+        FilePrefetch::stop();
+    }
+    delete[] _buffer;
     log_info("Run file closed");  // Used by OLED for elapsed time
 }
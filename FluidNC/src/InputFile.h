@@ -5,8 +5,12 @@
 // The file can be located on any supported file system, such as SD card or the local file system.
 // InputFile inherits from FileStream, adding the following features:
 //  - Reads lines delimited by newline
+//  - Reads the file in large blocks and splits lines out of memory, instead of
+//    reading it one byte at a time.  If $SD/Prefetch is on, the blocks are read
+//    ahead by a background task (see FilePrefetch.h).
 //  - For reporting the progress of GCode execution, counts the number of lines read and
-//    the percentage of the file size that has currently been read.
+//    the percentage of the file size that has currently been read.  The progress
+//    string is only formatted when a status report asks for it.
 //  - For reporting status, remembers the I/O channel that started the process of using the file.
 // FileStream's Channel member is not that same Channel that FileStream ultimately
 // inherits from; rather it is a separate channel that is use for status reporting.
@@ -18,20 +22,53 @@
 #include "Error.h"
 
 #include <cstdint>
+#include <mutex>
+#include <string>
+
+class Print;
 
 class InputFile : public FileStream {
 private:
+    static const size_t blockSize = 4096;
+
+    char*       _buffer = nullptr;  // Read-ahead buffer, when not prefetching
+    const char* _block  = nullptr;  // The block being split into lines
+    bool        _prefetching;       // Blocks come from FilePrefetch
+
+    size_t _blockLen = 0;  // Number of valid bytes in _block
+    size_t _blockPos = 0;  // Offset of the next unread byte in _block
+    size_t _offset   = 0;  // File offset of the next unread byte
+
+    std::string _pathName;  // Cached for progress reports
+
+    // The file whose progress appears in status reports.  It is set and
+    // the file is deleted by the polling task, but reports are formatted
+    // by other tasks, so changes and reads hold _progressMutex.
+    static InputFile* _progressFile;
+    static std::mutex _progressMutex;
+
+    static void set_progress_file(InputFile* file);
+
+    bool fill();
+
     WebUI::AuthenticationLevel _auth_level;
 
     // The channel that triggered the use of this file, through which
     // status about the use of this file will be reported.
     Channel& _out;
 
+    bool _readyNext = true;
+
+protected:
     uint32_t _line_num;  // the most recent line number read
-    bool     _readyNext = true;
+
+    // Copies the next len bytes of the file to dst.  Returns false if
+    // the file ends first.
+    bool read_bytes(void* dst, size_t len);
 
 public:
-    static std::string _progress;
+    // Writes "|SD:<percent>,<path>" for the running file job, if any
+    static void report_progress(Print& out);
 
     // fsname is the default file system on which the file is located, in case the path does not specify
     // path is the full path to the file
@@ -41,6 +78,11 @@ public:
     InputFile(const InputFile&) = delete;
     InputFile& operator=(const InputFile&) = delete;
 
+    // Opens a GCode file for running, as a TokenizedFile if it has
+    // the pre-tokenized extension or as a plain InputFile otherwise.
+    // Throws an Error if the file cannot be opened.
+    static InputFile* open(const char* fsname, const char* path, WebUI::AuthenticationLevel auth_level, Channel& channel);
+
     // readLine() differs from pollLine() in the Channel API as follows:
 
     // pollLine() is used with character-oriented input Channels whose
@@ -52,7 +94,7 @@ public:
     // data, you either get it "immediately" or you get a response
     // saying you will never get it (error or end-of-file).
 
-    Error readLine(char* line, int len);
+    virtual Error readLine(char* line, int len);
 
     // These are used for feedback about the progress of the operation
     uint32_t getLineNumber() { return _line_num; }
@@ -69,5 +111,5 @@ public:
     Channel* pollLine(char* line) override;
     void     stopJob() override;
 
-    ~InputFile();
+    virtual ~InputFile();
 };
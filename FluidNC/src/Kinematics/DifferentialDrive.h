@@ -22,6 +22,7 @@ namespace Kinematics {
         bool canHome(AxisMask axisMask) override;
         void releaseMotors(AxisMask axisMask, MotorMask motors) override;
         bool limitReached(AxisMask& axisMask, MotorMask& motors, MotorMask limited) override;
+        bool segmentsLines() const override { return true; }
 
         void afterParse() override {}
         virtual void group(Configuration::HandlerBase& handler) override;
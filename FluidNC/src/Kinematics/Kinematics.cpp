@@ -33,6 +33,11 @@ namespace Kinematics {
         return _system->limitReached(axisMask, motors, limited);
     }
 
+    bool Kinematics::segmentsLines() {
+        Assert(_system != nullptr, "No kinematics system.");
+        return _system->segmentsLines();
+    }
+
     void Kinematics::transform_cartesian_to_motors(float* motors, float* cartesian) {
         Assert(_system != nullptr, "No kinematics system.");
         return _system->transform_cartesian_to_motors(motors, cartesian);
@@ -25,6 +25,7 @@ namespace Kinematics {
 
         void init() override;
         bool canHome(AxisMask axisMask) override;
+        bool segmentsLines() const override { return true; }
         void init_position() override;
         bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
         void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
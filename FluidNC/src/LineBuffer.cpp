@@ -0,0 +1,62 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "LineBuffer.h"
+
+#include <cmath>
+
+size_t format_fixed(char* out, float value, int decimals) {
+    static const uint32_t scales[] = { 1, 10, 100, 1000, 10000 };
+
+    char* p = out;
+    if (std::isnan(value)) {
+        strcpy(out, "nan");
+        return 3;
+    }
+    if (decimals < 0) {
+        decimals = 0;
+    } else if (decimals > 4) {
+        decimals = 4;
+    }
+    uint32_t scale = scales[decimals];
+
+    bool negative = value < 0;
+    if (negative) {
+        value = -value;
+    }
+    // Round once in the scaled domain so that e.g. 1.9996 with 3 decimals carries into the integer part
+    double rounded = double(value) * scale + 0.5;
+    if (negative && rounded >= 1.0) {  // Do not report -0.000
+        *p++ = '-';
+    }
+    // Infinity, and values too large for the integer conversion, which would be undefined
+    if (!(rounded < 18446744073709551616.0)) {
+        strcpy(p, "inf");
+        return p + 3 - out;
+    }
+    uint64_t scaled = uint64_t(rounded);
+
+    uint64_t whole = scaled / scale;
+    uint32_t frac  = uint32_t(scaled % scale);
+
+    char  digits[20];
+    char* d = digits;
+    do {
+        *d++ = '0' + char(whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (d > digits) {
+        *p++ = *--d;
+    }
+
+    if (decimals) {
+        *p++ = '.';
+        for (int i = decimals - 1; i >= 0; --i) {
+            p[i] = '0' + char(frac % 10);
+            frac /= 10;
+        }
+        p += decimals;
+    }
+    *p = '\0';
+    return p - out;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// LineBuffer is a Print that formats into fixed storage instead of a
+// heap-allocated std::string, for messages such as status reports that
+// are produced many times per second.  Output that does not fit is
+// silently truncated.
+
+#include <Print.h>
+
+#include <cstdint>
+#include <cstring>
+
+// Formats value with the given number of decimals (0-4) into out, which
+// must have room for at least 24 characters.  Returns the length, not
+// counting the terminating NUL.  NaN is written as "nan", and infinity or
+// a value too large to format as "inf" or "-inf".
+size_t format_fixed(char* out, float value, int decimals);
+
+template <size_t N>
+class LineBuffer : public Print {
+    char   _data[N];
+    size_t _len = 0;
+
+public:
+    LineBuffer() { _data[0] = '\0'; }
+
+    using Print::write;
+
+    size_t write(uint8_t c) override {
+        if (_len >= N - 1) {
+            return 0;
+        }
+        _data[_len++] = c;
+        return 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t length) override {
+        if (length > N - 1 - _len) {
+            length = N - 1 - _len;
+        }
+        memcpy(_data + _len, buffer, length);
+        _len += length;
+        return length;
+    }
+
+    // Appends a fixed-point number without going through Print::printFloat()
+    void fixed(float value, int decimals) {
+        char tmp[24];
+        write((const uint8_t*)tmp, format_fixed(tmp, value, decimals));
+    }
+
+    void clear() { _len = 0; }
+
+    const char* c_str() {
+        _data[_len] = '\0';
+        return _data;
+    }
+    size_t length() { return _len; }
+};
@@ -1,5 +1,89 @@
 #include "List.h"
-#include "Machine/MachineConfig.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// A chunk of a list's string pool; the strings follow the header
+struct ListChunk {
+    struct ListChunk *next;
+    size_t size;
+    size_t used;
+};
+
+// An interned string; the text follows the header
+struct ListString {
+    struct ListString *chain;   // Next string in the same intern bucket
+};
+
+// Totals across all lists, for List::stats()
+static size_t total_nodes = 0;
+static size_t total_arena_bytes = 0;
+
+static const size_t legacy_node_size = (3 * sizeof(void*) + LIST_NAME_MAX_STR + LIST_NAME_MAX_PATH + 2 + 3) & ~size_t(3);
+
+// Helper functions to map a node index to its block, which holds LIST_BLOCK_NODES << block nodes
+static int block_of(ListIndex index) {
+    return 31 - __builtin_clz(index / LIST_BLOCK_NODES + 1);
+}
+
+static size_t block_start(int block) {
+    return LIST_BLOCK_NODES * ((size_t(1) << block) - 1);
+}
+
+// Helper function to allocate from the list's string pool
+static char *pool_alloc(ListType *list, size_t bytes) {
+
+    // Keep the string headers aligned
+    bytes = (bytes + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    struct ListChunk *chunk = list->chunks;
+    if (!chunk || chunk->size - chunk->used < bytes) {
+        size_t size = bytes > LIST_CHUNK_SIZE ? bytes : LIST_CHUNK_SIZE;
+        chunk = (struct ListChunk*)malloc(sizeof(struct ListChunk) + size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = list->chunks;
+        chunk->size = size;
+        chunk->used = 0;
+        list->chunks = chunk;
+        total_arena_bytes += sizeof(struct ListChunk) + size;
+    }
+    char *p = (char*)(chunk + 1) + chunk->used;
+    chunk->used += bytes;
+    return p;
+}
+
+// Helper function to intern a string, cut off at max_len - 1 characters like the old fixed-size fields
+static const char *intern(ListType *list, const char *str, size_t max_len) {
+
+    size_t len = strnlen(str, max_len - 1);
+
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ uint8_t(str[i])) * 16777619u;
+    }
+    struct ListString **bucket = &list->interned[hash % LIST_INTERN_BUCKETS];
+
+    // Reuse an identical string
+    for (struct ListString *s = *bucket; s; s = s->chain) {
+        const char *text = (const char*)(s + 1);
+        if (strncmp(text, str, len) == 0 && text[len] == '\0') {
+            return text;
+        }
+    }
+
+    struct ListString *s = (struct ListString*)pool_alloc(list, sizeof(struct ListString) + len + 1);
+    if (!s) {
+        return "";
+    }
+    char *text = (char*)(s + 1);
+    memcpy(text, str, len);
+    text[len] = '\0';
+    s->chain = *bucket;
+    *bucket = s;
+    return text;
+}
 
 // Constructor
 List::List() {}
@@ -9,86 +93,127 @@ List::~List() {}
 
 // Initializes a list with default settings
 void List::init(ListType *list, ListType *parent) {
-    
+
     // Initialize the list to empty with no active window
-    list->head = list->active_head = NULL;
+    remove_entries(list);
 
     // Set the parent list if one exists
     list->parent = parent;
 }
 
+// Returns the node at the given index, or NULL past the end of the list
+ListNodeType *List::node(ListType *list, ListIndex index) {
+    if (index >= list->count) {
+        return NULL;
+    }
+    int block = block_of(index);
+    return &list->blocks[block][index - block_start(block)];
+}
+
+ListNodeType *List::next(ListType *list, ListNodeType *entry) {
+    return entry ? node(list, entry->next) : NULL;
+}
+
+ListNodeType *List::prev(ListType *list, ListNodeType *entry) {
+    return entry ? node(list, entry->prev) : NULL;
+}
+
+List::Stats List::stats() {
+    return { total_nodes, total_arena_bytes, total_nodes * legacy_node_size };
+}
+
 // Adds a node entry to the given list
 void List::add_entry(ListType *list, ListType *sublist, const char *path, const char *display_name, bool updated) {
 
-    // Allocate memory for the new entry
-    struct ListNodeType* new_entry = (ListNodeType*)malloc(sizeof(struct ListNodeType));
+    ListIndex index = list->count;
+    if (index >= block_start(LIST_MAX_BLOCKS)) {
+        return;  // List is full
+    }
+
+    // Allocate the next node block when the current one is full
+    int block = block_of(index);
+    if (!list->blocks[block]) {
+        size_t bytes = (size_t(LIST_BLOCK_NODES) << block) * sizeof(ListNodeType);
+        list->blocks[block] = (ListNodeType*)malloc(bytes);
+        if (!list->blocks[block]) {
+            return;
+        }
+        total_arena_bytes += bytes;
+    }
+    struct ListNodeType* new_entry = &list->blocks[block][index - block_start(block)];
 
     // Populate the entry
-    new_entry->prev = NULL;
-    new_entry->next = NULL;
+    new_entry->prev = LIST_NONE;
+    new_entry->next = LIST_NONE;
 
     new_entry->child = sublist;
 
-    if (display_name) strncpy(new_entry->display_name, display_name, LIST_NAME_MAX_STR);    // Cuts off long display names
-    if (path) strncpy(new_entry->path, path, LIST_NAME_MAX_PATH);                           // Cuts off long file paths
+    new_entry->path = path ? intern(list, path, LIST_NAME_MAX_PATH) : NULL;                 // Cuts off long file paths
+    new_entry->display_name = NULL;
+    if (display_name) {
+
+        // A display name that ends the path, like a file name, shares its bytes
+        size_t name_len = strnlen(display_name, LIST_NAME_MAX_STR);
+        size_t path_len = new_entry->path ? strlen(new_entry->path) : 0;
+        if (name_len < LIST_NAME_MAX_STR && name_len <= path_len && strcmp(new_entry->path + path_len - name_len, display_name) == 0) {
+            new_entry->display_name = new_entry->path + path_len - name_len;
+        } else {
+            new_entry->display_name = intern(list, display_name, LIST_NAME_MAX_STR);          // Cuts off long display names
+        }
+    }
     new_entry->selected = false;
     new_entry->updated = updated;
 
+    list->count++;
+    total_nodes++;
+
     // No list entries, insert as the head, set as active window head and select it
-    if (list->head == NULL) {
-        new_entry->prev = NULL;
+    if (index == 0) {
         new_entry->selected = true;
-        list->head = new_entry;
-        list->active_head = new_entry;
+        list->head = index;
+        list->active_head = index;
+        list->tail = index;
         return;
     }
 
-    // List not empty, traverse to the end to add list item
-    struct ListNodeType* temp = list->head;
-
-    // Looking for tail
-    while (temp->next != NULL) {
-        temp = temp->next;
-    }
-
     // Add list item at the tail
-    temp->next = new_entry;
-    new_entry->prev = temp;
+    node(list, list->tail)->next = index;
+    new_entry->prev = list->tail;
+    list->tail = index;
 }
 
 // Deletes all nodes in the given list
 void List::remove_entries(ListType *list) {
 
-    struct ListNodeType* entry = list->head;
-
-    // Traverse the list until empty, clearing the memory for the nodes
-    while(entry) {
-
-        // Attach list head to next node
-        list->head = entry->next;
-
-        // Set new node to head unless it's empty
-        if (list->head) {
-            list->head->prev = NULL;
+    // Free the node blocks
+    for (int block = 0; block < LIST_MAX_BLOCKS; block++) {
+        if (list->blocks[block]) {
+            free(list->blocks[block]);
+            list->blocks[block] = NULL;
+            total_arena_bytes -= (size_t(LIST_BLOCK_NODES) << block) * sizeof(ListNodeType);
         }
+    }
 
-        // Free the old node memory
-        free(entry);
-        entry = NULL;
-
-        // Advance the pointer
-        entry = list->head;
+    // Free the string pool
+    while (list->chunks) {
+        struct ListChunk *chunk = list->chunks;
+        list->chunks = chunk->next;
+        total_arena_bytes -= sizeof(struct ListChunk) + chunk->size;
+        free(chunk);
     }
+    memset(list->interned, 0, sizeof(list->interned));
 
-    // Mark the head and active head NULL to prevent use-after-free
-    list->head = list->active_head = NULL;
+    // Mark the list empty to prevent use-after-free
+    total_nodes -= list->count;
+    list->count = 0;
+    list->head = list->active_head = list->tail = 0;
 }
 
 // Prepares the given list for an update
 void List::prep(ListType *list, bool add_back_btn) {
 
     // Clear out the menu nodes if they already exist
-    if (list->head) {
+    if (list->count) {
         remove_entries(list);
     }
 
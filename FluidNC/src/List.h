@@ -1,22 +1,37 @@
 #pragma once
 
-#include "Config.h"
+#include <cstddef>
+#include <cstdint>
 
 #define LIST_NAME_MAX_STR   40
 #define LIST_NAME_MAX_PATH  255
 
+// Lists keep their nodes and strings in per-list arenas instead of one
+// malloc'd node per entry.  Nodes are linked by index and live in blocks
+// that double in size, so a node never moves once added.  Strings are
+// interned in a pool of chunks: an entry whose display name ends its
+// path shares the path's bytes, and repeated strings are stored once.
+// Emptying a list frees its arenas in one pass.
+
+typedef uint16_t ListIndex;
+#define LIST_NONE           0xFFFF
+#define LIST_BLOCK_NODES    16      // Nodes in the first block; each later block doubles
+#define LIST_MAX_BLOCKS     12      // Room for 65520 nodes
+#define LIST_CHUNK_SIZE     512     // String pool chunk size
+#define LIST_INTERN_BUCKETS 16
+
 typedef struct ListNodeType
 {
     // List neighbor attributes
-    struct ListNodeType *prev;
-    struct ListNodeType *next;
+    ListIndex prev;
+    ListIndex next;
 
     // Submenu attributes
     struct ListType *child;
 
     // List entry characteristics
-    char display_name[LIST_NAME_MAX_STR];
-    char path[LIST_NAME_MAX_PATH];
+    const char *display_name;
+    const char *path;
     bool selected;
     bool updated; // optional updated flag (used for RSS updates, etc)
 
@@ -24,8 +39,15 @@ typedef struct ListNodeType
 
 typedef struct ListType {
     struct ListType *parent;
-    struct ListNodeType *head;
-    struct ListNodeType *active_head;
+    ListIndex head;
+    ListIndex active_head;
+    ListIndex tail;
+    ListIndex count;
+
+    // Arenas; a new ListType must be zeroed, e.g. with new ListType()
+    ListNodeType *blocks[LIST_MAX_BLOCKS];
+    struct ListChunk *chunks;
+    struct ListString *interned[LIST_INTERN_BUCKETS];
 } ListType;
 
 class List {
@@ -38,7 +60,18 @@ protected:
     void prep(ListType *list, bool add_back_btn = true);
 
 public:
-   
+
+    struct Stats {
+        size_t nodes;       // In all lists
+        size_t arenaBytes;  // Allocated for node blocks and string chunks
+        size_t legacyBytes; // What the nodes would take as fixed-size malloc'd entries
+    };
+    static Stats stats();
+
+    static ListNodeType *node(ListType *list, ListIndex index);
+    static ListNodeType *next(ListType *list, ListNodeType *entry);
+    static ListNodeType *prev(ListType *list, ListNodeType *entry);
+
     List();
     ~List();
 };
@@ -6,24 +6,42 @@
 #include "Serial.h"
 #include "SettingsDefinitions.h"
 
+#include <cstring>
+
 bool atMsgLevel(MsgLevel level) {
     return message_level == nullptr || message_level->get() >= level;
 }
 
 LogStream::LogStream(Channel& channel, const char* name) : _channel(channel) {
-    _line = new std::string();
     print(name);
 }
 LogStream::LogStream(const char* name) : LogStream(allChannels, name) {}
 
 size_t LogStream::write(uint8_t c) {
-    *_line += (char)c;
-    return 1;
+    return write(&c, 1);
+}
+
+size_t LogStream::write(const uint8_t* buffer, size_t length) {
+    if (!_line && _len + length <= bufSize) {
+        memcpy(_buf + _len, buffer, length);
+        _len += length;
+        return length;
+    }
+    if (!_line) {
+        _line = new std::string(_buf, _len);
+    }
+    _line->append((const char*)buffer, length);
+    return length;
 }
 
 LogStream::~LogStream() {
-    if ((*_line).length() && (*_line)[0] == '[') {
-        *_line += ']';
+    char first = _line ? (_line->length() ? (*_line)[0] : '\0') : (_len ? _buf[0] : '\0');
+    if (first == '[') {
+        write(']');
+    }
+    if (_line) {
+        send_line(_channel, _line);
+    } else {
+        send_line(_channel, _buf, _len);
     }
-    send_line(_channel, _line);
 }
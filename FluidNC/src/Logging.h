@@ -35,12 +35,19 @@ class LogStream : public Print {
 public:
     LogStream(Channel& channel, const char* name);
     LogStream(const char* name);
+    using Print::write;
     size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t length) override;
     ~LogStream();
 
 private:
+    // Typical lines fit in _buf; only longer ones spill to the heap
+    static const size_t bufSize = 128;
+
     Channel&     _channel;
-    std::string* _line;
+    char         _buf[bufSize];
+    size_t       _len  = 0;
+    std::string* _line = nullptr;
 };
 
 extern bool atMsgLevel(MsgLevel level);
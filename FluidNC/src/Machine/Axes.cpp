@@ -7,6 +7,7 @@
 #include "../Stepper.h"     // stepper_id_t
 #include "MachineConfig.h"  // config->
 #include "../Limits.h"
+#include "Driver/tmc_spi.h"  // tmc_spi_batch_begin()
 
 EnumItem axisType[] = { { 0, "X" }, { 1, "Y" }, { 2, "Z" }, { 3, "A" }, { 4, "B" }, { 5, "C" }, EnumItem(0) };
 
@@ -50,6 +51,8 @@ namespace Machine {
         _homed = false;
 
         config_motors();
+
+        _stepMap.build(*this);
     }
 
     void IRAM_ATTR Axes::set_disable(int axis, bool disable) {
@@ -74,6 +77,8 @@ namespace Machine {
     MotorMask Axes::set_homing_mode(AxisMask axisMask, bool isHoming) {
         MotorMask motorsCanHome = 0;
 
+        // Trinamic register changes for all the motors go out together
+        tmc_spi_batch_begin();
         for (size_t axis = X_AXIS; axis < _numberAxis; axis++) {
             if (bitnum_is_true(axisMask, axis)) {
                 auto a = _axis[axis];
@@ -90,70 +95,39 @@ namespace Machine {
                 }
             }
         }
+        tmc_spi_batch_end();
 
         return motorsCanHome;
     }
 
     void IRAM_ATTR Axes::step(uint8_t step_mask, uint8_t dir_mask) {
-        auto n_axis = _numberAxis;
-        //log_info("motors_set_direction_pins:0x%02X", onMask);
-
         // Set the direction pins, but optimize for the common
         // situation where the direction bits haven't changed.
         static uint8_t previous_dir = 255;  // should never be this value
         if (dir_mask != previous_dir) {
             previous_dir = dir_mask;
-
-            for (int axis = X_AXIS; axis < n_axis; axis++) {
-                bool thisDir = bitnum_is_true(dir_mask, axis);
-
-                for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
-                    auto m = _axis[axis]->_motors[motor];
-                    if (m) {
-                        m->_driver->set_direction(thisDir);
-                    }
-                }
-            }
+            _stepMap.set_direction(dir_mask);
             config->_stepping->waitDirection();
         }
 
         // Turn on step pulses for motors that are supposed to step now
-        for (size_t axis = X_AXIS; axis < n_axis; axis++) {
-            if (bitnum_is_true(step_mask, axis)) {
-                bool dir = bitnum_is_true(dir_mask, axis);
-
-                auto a = _axis[axis];
-                for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
-                    auto m = a->_motors[motor];
-                    if (m) {
-                        m->step(dir);
-                    }
-                }
-            }
-        }
+        _stepMap.step(step_mask, dir_mask);
         config->_stepping->startPulseTimer();
     }
 
     // Turn all stepper pins off
     void IRAM_ATTR Axes::unstep() {
         config->_stepping->waitPulse();
-        auto n_axis = _numberAxis;
-        for (size_t axis = X_AXIS; axis < n_axis; axis++) {
-            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
-                auto m = _axis[axis]->_motors[motor];
-                if (m) {
-                    m->_driver->unstep();
-                }
-            }
-        }
-
+        _stepMap.unstep();
         config->_stepping->finishPulse();
     }
 
     void Axes::config_motors() {
+        tmc_spi_batch_begin();
         for (int axis = 0; axis < _numberAxis; ++axis) {
             _axis[axis]->config_motors();
         }
+        tmc_spi_batch_end();
     }
 
     // Some small helpers to find the axis index and axis motor index for a given motor. This
@@ -6,6 +6,7 @@
 
 #include "../Configuration/Configurable.h"
 #include "Axis.h"
+#include "StepMap.h"
 #include "../EnumItem.h"
 
 namespace MotorDrivers {
@@ -16,6 +17,8 @@ namespace Machine {
     class Axes : public Configuration::Configurable {
         bool _switchedStepper = false;
 
+        StepMap _stepMap;
+
     public:
         static constexpr const char* _names = "XYZABC";
 
@@ -84,7 +84,9 @@ namespace Machine {
         handler.item("report_inches", _reportInches);
         handler.item("enable_parking_override_control", _enableParkingOverrideControl);
         handler.item("use_line_numbers", _useLineNumbers);
-        handler.item("planner_blocks", _planner_blocks, 10, 120);
+        handler.item("planner_blocks", _planner_blocks, 10, 1000);
+        handler.item("planner_psram", _planner_psram);
+        handler.item("planner_horizon", _planner_horizon, 0, 1000);
     }
 
     void MachineConfig::afterParse() {
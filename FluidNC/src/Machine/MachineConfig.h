@@ -90,7 +90,9 @@ namespace Machine {
         bool  _verboseErrors     = false;
         bool  _reportInches      = false;
 
-        size_t _planner_blocks = 16;
+        size_t _planner_blocks  = 16;
+        bool   _planner_psram   = false;  // Allocate the planner blocks in PSRAM, for deep look-ahead
+        size_t _planner_horizon = 0;      // Most blocks replanned per new block; 0 for no limit
 
         // Enables a special set of M-code commands that enables and disables the parking motion.
         // These are controlled by `M56`, `M56 P1`, or `M56 Px` to enable and `M56 P0` to disable.
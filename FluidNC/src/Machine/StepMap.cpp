@@ -0,0 +1,125 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "StepMap.h"
+
+#include "Axes.h"
+#include "Motor.h"
+#include "../Motors/MotorDriver.h"
+#include "../Pin.h"
+#include "../I2SOut.h"            // i2s_out_write_mask()
+#include "../NutsBolts.h"         // bitnum_is_true()
+#include "Driver/fluidnc_gpio.h"  // gpio_write_mask()
+#include "../Logging.h"
+
+namespace Machine {
+    bool StepMap::PortBits::add(const Pin& pin, bool level) {
+        if (pin.undefined()) {
+            return true;
+        }
+        auto caps = pin.capabilities();
+        bool high = level ^ pin.getAttr().has(Pin::Attr::ActiveLow);
+        if (caps.has(Pin::Capabilities::Native)) {
+            uint64_t bit = uint64_t(1) << pin.getNative(Pin::Capabilities::Output);
+            (high ? gpioSet : gpioClear) |= bit;
+            return true;
+        }
+        if (caps.has(Pin::Capabilities::I2S)) {
+            uint32_t bit = uint32_t(1) << pin.getNative(Pin::Capabilities::I2S);
+            (high ? i2soSet : i2soClear) |= bit;
+            return true;
+        }
+        return false;
+    }
+
+    void IRAM_ATTR StepMap::PortBits::write() const {
+        if (gpioSet | gpioClear) {
+            gpio_write_mask(gpioSet, gpioClear);
+        }
+        if (i2soSet | i2soClear) {
+            i2s_out_write_mask(i2soSet, i2soClear);
+        }
+    }
+
+    void StepMap::build(Axes& axes) {
+        _nAxis   = axes._numberAxis;
+        _stepOff = {};
+
+        size_t nMapped   = 0;
+        size_t nUnmapped = 0;
+        for (int axis = 0; axis < _nAxis; axis++) {
+            _nMapped[axis]    = 0;
+            _nUnmapped[axis]  = 0;
+            _dirReverse[axis] = {};
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto m = axes._axis[axis]->_motors[motor];
+                if (!m) {
+                    continue;
+                }
+                Pin*     step_pin;
+                Pin*     dir_pin;
+                PortBits stepOn;
+                PortBits dirReverse;
+                if (m->_driver->step_dir_pins(step_pin, dir_pin) && step_pin->defined() && stepOn.add(*step_pin, true) &&
+                    dirReverse.add(*dir_pin, true)) {
+                    // The map writes these pins behind the pin classes' backs
+                    step_pin->disableWriteCache();
+                    dir_pin->disableWriteCache();
+                    _mapped[axis][_nMapped[axis]++] = { m, stepOn };
+                    _stepOff.merge(stepOn.inverse());
+                    _dirReverse[axis].merge(dirReverse);
+                    ++nMapped;
+                } else {
+                    _unmapped[axis][_nUnmapped[axis]++] = m;
+                    ++nUnmapped;
+                }
+            }
+        }
+        log_debug("Step map: " << nMapped << " port-mapped motors, " << nUnmapped << " driver-stepped");
+    }
+
+    void IRAM_ATTR StepMap::set_direction(uint8_t dir_mask) {
+        PortBits bits;
+        for (int axis = 0; axis < _nAxis; axis++) {
+            bool reverse = bitnum_is_true(dir_mask, axis);
+            bits.merge(reverse ? _dirReverse[axis] : _dirReverse[axis].inverse());
+            for (size_t i = 0; i < _nUnmapped[axis]; i++) {
+                _unmapped[axis][i]->_driver->set_direction(reverse);
+            }
+        }
+        bits.write();
+    }
+
+    void IRAM_ATTR StepMap::step(uint8_t step_mask, uint8_t dir_mask) {
+        PortBits bits;
+        for (int axis = 0; axis < _nAxis; axis++) {
+            if (!bitnum_is_true(step_mask, axis)) {
+                continue;
+            }
+            bool reverse = bitnum_is_true(dir_mask, axis);
+            for (size_t i = 0; i < _nMapped[axis]; i++) {
+                auto& mapped = _mapped[axis][i];
+                auto  m      = mapped.motor;
+                // Skip steps based on limit pins and asymmetric pulloff, as Motor::step() does
+                if (m->_blocked || m->_limited) {
+                    continue;
+                }
+                bits.merge(mapped.stepOn);
+                m->_steps += reverse ? -1 : 1;
+            }
+            for (size_t i = 0; i < _nUnmapped[axis]; i++) {
+                _unmapped[axis][i]->step(reverse);
+            }
+        }
+        bits.write();
+    }
+
+    void IRAM_ATTR StepMap::unstep() {
+        _stepOff.write();
+        for (int axis = 0; axis < _nAxis; axis++) {
+            for (size_t i = 0; i < _nUnmapped[axis]; i++) {
+                _unmapped[axis][i]->unstep();
+            }
+        }
+    }
+}
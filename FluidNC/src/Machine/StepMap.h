@@ -0,0 +1,84 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  StepMap.h - drives step and direction pins with port-wide writes
+
+  Most motors are plain step/direction drivers whose pins are GPIOs or
+  I2SO bits.  Rather than calling step(), unstep() and set_direction()
+  through the motor driver and pin classes for each motor on every step
+  tick, the map collects those pins into set and clear masks when the
+  machine is configured, so a tick is one write per port.  Motors whose
+  drivers do something else - RMT stepping, servos, unipolar motors,
+  pins on I/O extenders - keep using the virtual driver calls.
+*/
+
+#include "../Config.h"  // MAX_N_AXIS
+#include "Axis.h"       // Axis::MAX_MOTORS_PER_AXIS
+
+#include <cstdint>
+
+class Pin;
+
+namespace Machine {
+    class Axes;
+    class Motor;
+
+    class StepMap {
+    public:
+        // Bits to set and clear on the GPIO and I2SO ports
+        struct PortBits {
+            uint64_t gpioSet   = 0;
+            uint64_t gpioClear = 0;
+            uint32_t i2soSet   = 0;
+            uint32_t i2soClear = 0;
+
+            // Adds the bit that drives pin to the given logical level.
+            // Returns false if the pin cannot be written through a port mask.
+            bool add(const Pin& pin, bool level);
+
+            void merge(const PortBits& other) {
+                gpioSet |= other.gpioSet;
+                gpioClear |= other.gpioClear;
+                i2soSet |= other.i2soSet;
+                i2soClear |= other.i2soClear;
+            }
+
+            // The same pins driven to the opposite levels
+            PortBits inverse() const {
+                PortBits bits;
+                bits.gpioSet   = gpioClear;
+                bits.gpioClear = gpioSet;
+                bits.i2soSet   = i2soClear;
+                bits.i2soClear = i2soSet;
+                return bits;
+            }
+
+            void write() const;
+        };
+
+        void build(Axes& axes);
+
+        void set_direction(uint8_t dir_mask);
+        void step(uint8_t step_mask, uint8_t dir_mask);
+        void unstep();
+
+    private:
+        struct MappedMotor {
+            Motor*   motor;
+            PortBits stepOn;
+        };
+
+        int _nAxis = 0;
+
+        MappedMotor _mapped[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];
+        uint8_t     _nMapped[MAX_N_AXIS] = { 0 };
+        PortBits    _dirReverse[MAX_N_AXIS];  // Direction pins of the mapped motors, for a set dir_mask bit
+        PortBits    _stepOff;                 // Step pins of all mapped motors, inactive
+
+        Motor*  _unmapped[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];
+        uint8_t _nUnmapped[MAX_N_AXIS] = { 0 };
+    };
+}
@@ -1,16 +1,17 @@
 #include "Menu.h"
 #include "Machine/MachineConfig.h"
+#include "SDIndex.h"
 
 // Constructor
 Menu::Menu() {
 
     // Allocate memory for the menus
-    _main_menu = new struct ListType;
-    _files_menu = new struct ListType;
-    _jogging_menu = new struct ListType;
+    _main_menu = new struct ListType();
+    _files_menu = new struct ListType();
+    _jogging_menu = new struct ListType();
     // _rss_menu is handled by RSSReader
-    _settings_menu = new struct ListType;
-    _version_menu = new struct ListType;
+    _settings_menu = new struct ListType();
+    _version_menu = new struct ListType();
 
     // Initialize the menus
     init(_main_menu, NULL);
@@ -71,15 +72,19 @@ void Menu::connect_rss_feed(ListType *feed) {
 
 // Returns the active menu head
 struct ListNodeType *Menu::get_active_head(void) {
-    return _current_menu->active_head;
+    return node(_current_menu, _current_menu->active_head);
+}
+
+// Returns the entry after the given one in the current menu
+struct ListNodeType *Menu::get_next(ListNodeType *entry) {
+    return next(_current_menu, entry);
 }
 
 // Returns the selected entry
 struct ListNodeType *Menu::get_selected(void) {
 
     // Traverse the list and print out each menu entry name
-    ListNodeType *entry = _current_menu->active_head; // Start at the beginning of the active window
-    int i = 0;
+    ListNodeType *entry = get_active_head(); // Start at the beginning of the active window
     while (entry) {
 
         // Found selected entry
@@ -87,7 +92,7 @@ struct ListNodeType *Menu::get_selected(void) {
             break;
 
         // Advance the line and pointer
-        entry = entry->next;
+        entry = next(_current_menu, entry);
     }
 
     return entry;
@@ -104,6 +109,11 @@ void Menu::enter_submenu(void) {
         // Make the submenu active
         _current_menu = selected_entry->child;      
 
+        // The files menu is the only user of the SD index
+        if (_current_menu == _files_menu && config->_sdCard) {
+            config->_sdCard->indexFiles();
+        }
+
         // Refresh the display
         if (config->_oled) {
             config->_oled->refresh_display();
@@ -135,11 +145,11 @@ struct ListNodeType *Menu::get_active_tail(ListType *menu, int max_active_entrie
     int num_active_nodes = 0;
 
     // Traverse the linked list
-    entry = menu->head;  // Reset to head
-    while (entry->next && num_active_nodes < (max_active_entries - 1)) {
+    entry = node(menu, menu->head);  // Reset to head
+    while (next(menu, entry) && num_active_nodes < (max_active_entries - 1)) {
 
         // Count the active window nodes
-        if (entry == menu->active_head) {
+        if (entry == node(menu, menu->active_head)) {
             active_area = true;
         }
         if (active_area) {
@@ -147,16 +157,16 @@ struct ListNodeType *Menu::get_active_tail(ListType *menu, int max_active_entrie
         }
 
         // Go to the next entry
-        entry = entry->next;
+        entry = next(menu, entry);
     }
     return entry;
 }
 
 // Helper function to add SD file to files menu
-void Menu::add_sd_file(char *path) {
+void Menu::add_sd_file(const char *path) {
 
     // Extract the display name from the full path
-    char *filename = strrchr(path, '/') + 1;
+    const char *filename = strrchr(path, '/') + 1;
         
     // Initialize the files menu and attach nodes
     add_entry(_files_menu, NULL, path, filename);
@@ -165,6 +175,30 @@ void Menu::add_sd_file(char *path) {
 // Helper function to prep for updated SD file list
 void Menu::prep_for_sd_update(void) {
     prep(_files_menu);
+    _files_loaded = 0;
+}
+
+// Helper function to add the next SD index entries to the files menu
+void Menu::load_sd_files(size_t count) {
+    std::string path;
+    while (count-- && sdIndex.get(_files_loaded, path)) {
+        add_sd_file(path.c_str());
+        ++_files_loaded;
+    }
+}
+
+// Rebuilds the first page of the files menu if the SD index has changed,
+// returning true if it did
+bool Menu::sync_sd_files(void) {
+    uint32_t generation = sdIndex.generation();
+    if (generation == _files_generation) {
+        return false;
+    }
+    _files_generation = generation;
+
+    prep_for_sd_update();
+    load_sd_files(files_page);
+    return true;
 }
 
 // Builds the menu system
@@ -205,8 +239,8 @@ void Menu::build(void) {
 // Updates the current menu selection
 void Menu::update_selection(int max_active_entries, int enc_diff) {
 
-    ListNodeType *entry = _current_menu->head;  // Start at the top of the active menu
-    ListNodeType *active_tail;
+    ListNodeType *entry = node(_current_menu, _current_menu->head);  // Start at the top of the active menu
+    ListNodeType *active_head, *active_tail, *neighbor;
 
     // Lock out scrolling during operation
     if (sys.state != State::Idle) {
@@ -218,20 +252,33 @@ void Menu::update_selection(int max_active_entries, int enc_diff) {
         // Found selected entry and we have scrolled
         if (entry->selected && (enc_diff != 0)) {
 
+            // Page in more files before the window runs past the loaded ones
+            if (enc_diff > 0 && _current_menu == _files_menu) {
+                ListNodeType *ahead = entry;
+                for (int i = 0; ahead && i < max_active_entries; i++) {
+                    ahead = next(_current_menu, ahead);
+                }
+                if (!ahead) {
+                    load_sd_files(files_page);
+                }
+            }
+
             // Adjust menu selection and active window as needed
-            if (enc_diff > 0 && entry->next != NULL) {        // Forwards until hit tail
-                entry->next->selected = true;
+            active_head = node(_current_menu, _current_menu->active_head);
+            if (enc_diff > 0 && (neighbor = next(_current_menu, entry)) != NULL) {        // Forwards until hit tail
+                neighbor->selected = true;
                 entry->selected = false;
-                active_tail = get_active_tail(_current_menu, max_active_entries);
-                if (active_tail->next && active_tail->next->selected) {  // Shift the window once scroll past max entries
-                    _current_menu->active_head = _current_menu->active_head->next;
+                active_tail = next(_current_menu, get_active_tail(_current_menu, max_active_entries));
+                if (active_tail && active_tail->selected) {  // Shift the window once scroll past max entries
+                    _current_menu->active_head = active_head->next;
                 }
 
-            } else if (enc_diff < 0 && entry->prev != NULL) { // Backwards until hit head
-                entry->prev->selected = true;
+            } else if (enc_diff < 0 && (neighbor = prev(_current_menu, entry)) != NULL) { // Backwards until hit head
+                neighbor->selected = true;
                 entry->selected = false;
-                if (_current_menu->active_head->prev && _current_menu->active_head->prev->selected) {  // Shift the window once scroll past max entries
-                    _current_menu->active_head = _current_menu->active_head->prev;
+                neighbor = prev(_current_menu, active_head);
+                if (neighbor && neighbor->selected) {  // Shift the window once scroll past max entries
+                    _current_menu->active_head = active_head->prev;
                 }
             }
             break;
@@ -240,7 +287,7 @@ void Menu::update_selection(int max_active_entries, int enc_diff) {
         } else if (entry->selected) {
             break;
         }
-        entry = entry->next;      
+        entry = next(_current_menu, entry);
     }
 }
 
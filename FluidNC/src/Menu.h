@@ -11,8 +11,14 @@ private:
 
     ListType *_main_menu, *_files_menu, *_jogging_menu, *_rss_menu, *_settings_menu, *_version_menu, *_current_menu;
 
+    // The files menu holds a window of the SD index, extended as the user scrolls
+    static const int files_page = 16;
+    uint32_t _files_generation = 0;  // Of the SD index that the files menu shows
+    size_t   _files_loaded     = 0;  // Index entries in the files menu
+
     struct ListNodeType *get_active_tail(ListType *menu, int max_active_entries);
     void build();
+    void load_sd_files(size_t count);
 
 public:
 
@@ -25,10 +31,12 @@ public:
 
     struct ListNodeType *get_active_head();
     struct ListNodeType *get_selected();
+    struct ListNodeType *get_next(struct ListNodeType *entry);
     void enter_submenu();
     void exit_submenu();
-    void add_sd_file(char *path);
+    void add_sd_file(const char *path);
     void prep_for_sd_update();
+    bool sync_sd_files();
     void update_selection(int max_active_entries, int enc_diff);
     bool is_full_width();
 };
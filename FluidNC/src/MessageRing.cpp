@@ -0,0 +1,87 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "MessageRing.h"
+
+#include <cstring>
+
+// Records are multiples of the header size, so a header always fits
+// at any record boundary, including just before the end of the buffer.
+static uint32_t record_size(size_t length, size_t header) {
+    return uint32_t((header + length + 1 + header - 1) / header * header);
+}
+
+MessageRing::MessageRing(uint32_t size) : _buffer(new char[size]), _size(size), _head(0), _tail(0) {
+    // Released space is zeroed so that a header claimed later reads as Empty until it is written
+    memset(_buffer, 0, _size);
+}
+
+MessageRing::~MessageRing() {
+    delete[] _buffer;
+}
+
+bool MessageRing::put(Channel* channel, const char* line, size_t length) {
+    if (length > max_length()) {
+        length = max_length();
+    }
+    uint32_t need = record_size(length, sizeof(Header));
+
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t pad;
+    while (true) {
+        uint32_t toEnd = _size - (head & (_size - 1));
+        pad            = need > toEnd ? toEnd : 0;
+        uint32_t tail  = _tail.load(std::memory_order_acquire);
+        if (head + pad + need - tail > _size) {
+            return false;
+        }
+        if (_head.compare_exchange_weak(head, head + pad + need, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    if (pad) {
+        Header* filler = at(head);
+        filler->size   = uint16_t(pad);
+        filler->state.store(Padding, std::memory_order_release);
+        head += pad;
+    }
+
+    Header* h  = at(head);
+    h->channel = channel;
+    h->size    = uint16_t(need);
+    char* text = reinterpret_cast<char*>(h + 1);
+    memcpy(text, line, length);
+    text[length] = '\0';
+    h->state.store(Ready, std::memory_order_release);
+    return true;
+}
+
+bool MessageRing::peek(Channel*& channel, const char*& line) {
+    while (true) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        Header* h     = at(tail);
+        uint8_t state = h->state.load(std::memory_order_acquire);
+        if (state == Empty) {
+            return false;  // Claimed but still being copied
+        }
+        if (state == Padding) {
+            release();
+            continue;
+        }
+        channel = h->channel;
+        line    = reinterpret_cast<const char*>(h + 1);
+        return true;
+    }
+}
+
+void MessageRing::release() {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    Header*  h    = at(tail);
+    uint32_t size = h->size;
+    memset(static_cast<void*>(h), 0, size);
+    _tail.store(tail + size, std::memory_order_release);
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  MessageRing.h - preallocated byte ring for outgoing lines
+
+  Any number of tasks can add lines concurrently; a single consumer (the
+  output task) removes them in order.  Each record holds the destination
+  channel and a NUL-terminated copy of the line, so sending a message
+  needs no heap allocation.
+
+  Producers claim space by advancing the head index with compare-and-swap,
+  copy their text outside of any lock, then mark the record ready.  The
+  consumer stops at the first record that is not yet ready, so lines are
+  always delivered in the order in which space was claimed.  A record never
+  wraps; if it does not fit before the end of the buffer, the remainder is
+  claimed as padding and the record starts at the beginning.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class Channel;
+
+class MessageRing {
+    enum : uint8_t {
+        Empty   = 0,  // Not yet written; the consumer must wait
+        Ready   = 1,
+        Padding = 2,  // Filler at the end of the buffer; skipped
+    };
+
+    struct Header {
+        Channel*             channel;
+        uint16_t             size;  // Total bytes in the record, including this header
+        std::atomic<uint8_t> state;
+    };
+
+    char*                 _buffer;
+    uint32_t              _size;  // Power of two
+    std::atomic<uint32_t> _head;  // Free-running byte counters; the offset is counter & (_size - 1)
+    std::atomic<uint32_t> _tail;
+
+    Header* at(uint32_t counter) { return reinterpret_cast<Header*>(_buffer + (counter & (_size - 1))); }
+
+public:
+    // size must be a power of two, no larger than 32768
+    MessageRing(uint32_t size);
+    ~MessageRing();
+
+    MessageRing(const MessageRing&) = delete;
+    MessageRing& operator=(const MessageRing&) = delete;
+
+    // The longest line that can be stored, not counting the NUL.  Half
+    // the ring, so that a record always fits once the ring drains,
+    // wherever the head happens to be.
+    size_t max_length() const { return _size / 2 - sizeof(Header) - 1; }
+
+    // Copies the line into the ring.  Returns false, without blocking,
+    // if there is not enough room; the caller decides whether to retry.
+    // Lines longer than max_length() are truncated, so callers that
+    // must not send part of a line check the length first.
+    bool put(Channel* channel, const char* line, size_t length);
+
+    // Consumer side: returns the oldest ready line, if any.  The line
+    // remains valid until release() is called.
+    bool peek(Channel*& channel, const char*& line);
+    void release();
+
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+};
@@ -0,0 +1,169 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Modbus.h"
+
+#include <cstring>
+
+namespace Modbus {
+    namespace {
+        struct CrcTable {
+            uint16_t entry[256];
+
+            constexpr CrcTable() : entry() {
+                for (int byte = 0; byte < 256; byte++) {
+                    uint16_t crc = byte;
+                    for (int bit = 0; bit < 8; bit++) {
+                        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+                    }
+                    entry[byte] = crc;
+                }
+            }
+        };
+        constexpr CrcTable crcTable;
+
+        bool crcMatches(const uint8_t* frame, size_t length) {
+            uint16_t crc = crc16(frame, length - 2);
+            return frame[length - 2] == (crc & 0xff) && frame[length - 1] == (crc >> 8);
+        }
+    }
+
+    uint16_t crc16(const uint8_t* data, size_t length) {
+        uint16_t crc = 0xFFFF;
+        while (length--) {
+            crc = (crc >> 8) ^ crcTable.entry[(crc ^ *data++) & 0xff];
+        }
+        return crc;
+    }
+
+    Master::Master(Port& port, uint32_t baud) : _port(port) {
+        // 3.5 character times of 11 bits, but at least the 1.75 ms that the
+        // spec fixes above 19200 baud, plus one for the millisecond clock.
+        _gapMs = (38500 + baud - 1) / baud;
+        if (_gapMs < 2) {
+            _gapMs = 2;
+        }
+        _gapMs += 1;
+    }
+
+    bool Master::submit(const Request& request) {
+        if (_count == size_t(queueSize) || request.txLength + 2u > maxFrame || request.rxLength + 2u > maxFrame) {
+            return false;
+        }
+        Request& r            = _queue[_count++];
+        r                     = request;
+        uint16_t crc          = crc16(r.msg, r.txLength);
+        r.msg[r.txLength]     = crc & 0xff;
+        r.msg[r.txLength + 1] = crc >> 8;
+        return true;
+    }
+
+    void Master::start(uint32_t now_ms) {
+        _port.discard();
+        _port.send(_current.msg, _current.txLength + 2);
+        _rxCount = 0;
+        _state   = State::Waiting;
+        _since   = now_ms;
+    }
+
+    void Master::finish(Result result, uint32_t now_ms) {
+        if (result == Result::Exception) {
+            ++_stats.exceptions;
+        } else if (result == Result::Failed) {
+            ++_stats.failures;
+        }
+        _state    = State::Gap;
+        _since    = now_ms;
+        _retrying = false;
+        if (_current.done) {
+            _current.done(_current, result, _rx);
+        }
+    }
+
+    void Master::retry(uint32_t now_ms) {
+        if (++_attempts >= _maxRetries) {
+            finish(Result::Failed, now_ms);
+            return;
+        }
+        ++_stats.retries;
+        _state    = State::Gap;
+        _since    = now_ms;
+        _retrying = true;
+    }
+
+    uint32_t Master::service(uint32_t now_ms) {
+        while (true) {
+            switch (_state) {
+                case State::Idle: {
+                    if (_count == 0) {
+                        return UINT32_MAX;
+                    }
+                    // The first of the highest-priority requests
+                    size_t next = 0;
+                    for (size_t i = 1; i < _count; i++) {
+                        if (_queue[i].priority > _queue[next].priority) {
+                            next = i;
+                        }
+                    }
+                    _current = _queue[next];
+                    for (size_t i = next + 1; i < _count; i++) {
+                        _queue[i - 1] = _queue[i];
+                    }
+                    --_count;
+                    _attempts = 0;
+                    ++_stats.transactions;
+                    start(now_ms);
+                    break;
+                }
+
+                case State::Waiting: {
+                    size_t  expected = _current.rxLength + 2;
+                    uint8_t slave    = _current.slave();
+                    size_t  n        = _port.receive(_rx + _rxCount, expected - _rxCount);
+
+                    // Some VFDs put a zero byte ahead of the response
+                    if (_rxCount == 0 && slave != 0) {
+                        size_t skip = 0;
+                        while (skip < n && _rx[skip] == 0) {
+                            ++skip;
+                        }
+                        memmove(_rx, _rx + skip, n - skip);
+                        n -= skip;
+                    }
+                    _rxCount += n;
+
+                    if (_rxCount >= 5 && _rx[0] == slave && (_rx[1] & 0x80) && crcMatches(_rx, 5)) {
+                        finish(Result::Exception, now_ms);
+                    } else if (_rxCount == expected) {
+                        if (_rx[0] == slave && crcMatches(_rx, expected)) {
+                            finish(Result::Ok, now_ms);
+                        } else {
+                            ++_stats.badFrames;
+                            retry(now_ms);
+                        }
+                    } else if (now_ms - _since >= _timeoutMs) {
+                        ++_stats.timeouts;
+                        retry(now_ms);
+                    } else {
+                        return 1;
+                    }
+                    break;
+                }
+
+                case State::Gap: {
+                    uint32_t elapsed = now_ms - _since;
+                    if (elapsed < _gapMs) {
+                        return _gapMs - elapsed;
+                    }
+                    if (_retrying) {
+                        _retrying = false;
+                        start(now_ms);
+                    } else {
+                        _state = State::Idle;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}
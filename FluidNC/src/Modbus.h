@@ -0,0 +1,125 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Modbus.h - non-blocking Modbus RTU master
+
+  The master owns one half-duplex bus and runs one transaction at a
+  time, as RTU requires, but it never waits for one.  The owner calls
+  service() with the current time whenever there might be something to
+  do; it sends the next request once the bus has been quiet for the
+  3.5 character inter-frame gap, collects response bytes as they arrive,
+  and completes the request when the response is whole, when the slave
+  answers with an exception, or when the response timeout runs out and
+  the retries are used up.
+
+  Requests wait in a small priority queue, so a setpoint submitted
+  while status polls are queued goes out as soon as the bus is free.
+  Each request carries its own slave address, so several devices can
+  share a bus.
+
+  The bus itself is a Port, which the owner implements on a UART or,
+  in tests, on a loopback.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Modbus {
+    static const size_t maxFrame = 32;  // Including the address and the CRC
+
+    // CRC-16/MODBUS, from a 256-entry table
+    uint16_t crc16(const uint8_t* data, size_t length);
+
+    class Port {
+    public:
+        virtual void   send(const uint8_t* data, size_t length) = 0;
+        virtual size_t receive(uint8_t* data, size_t length)    = 0;  // Returns what has arrived without waiting
+        virtual void   discard()                                = 0;  // Drops unread input
+        virtual ~Port() {}
+    };
+
+    // Higher priorities are sent first; requests of equal priority go in order
+    enum class Priority : uint8_t {
+        Poll     = 0,
+        Command  = 1,
+        Setpoint = 2,
+    };
+
+    enum class Result : uint8_t {
+        Ok,
+        Exception,  // The slave rejected the request
+        Failed,     // No valid response after all the retries
+    };
+
+    struct Request;
+    using Completion = void (*)(const Request& request, Result result, const uint8_t* response);
+
+    struct Request {
+        Priority   priority = Priority::Poll;
+        uint8_t    txLength = 0;  // Bytes in msg, starting with the slave address, without the CRC
+        uint8_t    rxLength = 0;  // Expected response length without the CRC
+        uint8_t    msg[maxFrame];
+        Completion done    = nullptr;
+        void*      context = nullptr;  // For the completion
+
+        uint8_t slave() const { return msg[0]; }
+    };
+
+    class Master {
+    public:
+        static const int queueSize = 8;
+
+        struct Stats {
+            uint32_t transactions = 0;
+            uint32_t retries      = 0;
+            uint32_t timeouts     = 0;
+            uint32_t badFrames    = 0;  // Wrong length, address or CRC
+            uint32_t exceptions   = 0;
+            uint32_t failures     = 0;
+        };
+
+        Master(Port& port, uint32_t baud);
+
+        // Appends the CRC and queues the request.  Returns false if the queue is full.
+        bool submit(const Request& request);
+
+        // Advances the transaction state machine without blocking.  Returns
+        // the number of milliseconds until it needs service again.
+        uint32_t service(uint32_t now_ms);
+
+        bool   idle() const { return _state == State::Idle && _count == 0; }
+        size_t queued() const { return _count; }
+
+        uint32_t _timeoutMs  = 1000;  // For the whole response to arrive
+        int      _maxRetries = 5;     // Attempts before the request fails
+        Stats    _stats;
+
+    private:
+        enum class State : uint8_t {
+            Idle,
+            Waiting,  // For the response
+            Gap,      // Inter-frame silence after a transaction
+        };
+
+        void start(uint32_t now_ms);
+        void finish(Result result, uint32_t now_ms);
+        void retry(uint32_t now_ms);
+
+        Port&    _port;
+        uint32_t _gapMs;
+
+        Request _queue[queueSize];
+        size_t  _count = 0;
+
+        State    _state = State::Idle;
+        Request  _current;
+        int      _attempts = 0;
+        bool     _retrying = false;  // Resend _current after the gap
+        uint32_t _since    = 0;      // When the current state began
+        uint8_t  _rx[maxFrame];
+        size_t   _rxCount = 0;
+    };
+}
@@ -14,6 +14,7 @@
 #include "I2SOut.h"          // i2s_out_reset
 #include "Platform.h"        // WEAK_LINK
 #include "Settings.h"        // coords
+#include "Raster.h"          // Raster::waiting, Raster::reject
 
 #include <cmath>
 
@@ -71,7 +72,7 @@ bool mc_move_motors(float* target, plan_line_data_t* pl_data) {
     // If the buffer is full: good! That means we are well ahead of the robot.
     // Remain in this loop until there is room in the buffer.
 
-    while (plan_check_full_buffer()) {
+    while (plan_check_full_buffer() || Raster::waiting()) {
         protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
 
         // While we are waiting for room in the buffer, look for realtime
@@ -105,9 +106,61 @@ bool mc_linear(float* target, plan_line_data_t* pl_data, float* position) {
     if (!pl_data->is_jog) { // soft limits for jogs have already been dealt with
         limits_soft_check(target);
     }    
+    // Only the first segment would get the pixels, so the line runs dark instead
+    if (config->_kinematics->segmentsLines() && Raster::reject()) {
+        pl_data->spindle_speed = 0;
+    }
     return config->_kinematics->cartesian_to_motors(target, pl_data, position);
 }
 
+// Checks soft limits against the bounding box of an arc, once for the whole arc instead of
+// once per chord.  The box is that of the true circle through the start and end points, so
+// it can be larger than the chords' by no more than the arc tolerance.
+static void arc_soft_check(float* target,
+                           float* position,
+                           float  center_axis0,
+                           float  center_axis1,
+                           float  start_angle,
+                           float  angular_travel,
+                           size_t axis_0,
+                           size_t axis_1,
+                           size_t n_axis) {
+    float lo[n_axis];
+    float hi[n_axis];
+    for (size_t i = 0; i < n_axis; i++) {
+        lo[i] = MIN(position[i], target[i]);
+        hi[i] = MAX(position[i], target[i]);
+    }
+    // Extend the box to each axis-aligned extreme of the circle that the arc sweeps through
+    float radius = hypotf(position[axis_0] - center_axis0, position[axis_1] - center_axis1);
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        float extreme_angle = quadrant * float(M_PI / 2);
+        float sweep         = angular_travel > 0 ? extreme_angle - start_angle : start_angle - extreme_angle;
+        sweep               = fmodf(sweep + 4 * float(M_PI), 2 * float(M_PI));
+        if (sweep > fabsf(angular_travel)) {
+            continue;
+        }
+        switch (quadrant) {
+            case 0:
+                hi[axis_0] = MAX(hi[axis_0], center_axis0 + radius);
+                break;
+            case 1:
+                hi[axis_1] = MAX(hi[axis_1], center_axis1 + radius);
+                break;
+            case 2:
+                lo[axis_0] = MIN(lo[axis_0], center_axis0 - radius);
+                break;
+            case 3:
+                lo[axis_1] = MIN(lo[axis_1], center_axis1 - radius);
+                break;
+        }
+    }
+    limits_soft_check(lo);
+    if (!sys.abort) {
+        limits_soft_check(hi);
+    }
+}
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_X defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, isclockwise boolean. Used
@@ -134,11 +187,6 @@ void mc_arc(float*            target,
 
     auto n_axis = config->_axes->_numberAxis;
 
-    float previous_position[n_axis] = { 0.0 };
-    for (size_t i = 0; i < n_axis; i++) {
-        previous_position[i] = position[i];
-    }
-
     // CCW angle between position and target from circle center. Only one atan2() trig computation required.
     float angular_travel = atan2f(r_axis0 * rt_axis1 - r_axis1 * rt_axis0, r_axis0 * rt_axis0 + r_axis1 * rt_axis1);
     if (is_clockwise_arc) {  // Correct atan2 output per direction
@@ -163,59 +211,82 @@ void mc_arc(float*            target,
     // NOTE: Segment end points are on the arc, which can lead to the arc diameter being smaller by up to
     // (2x) arc_tolerance. For 99% of users, this is just fine. If a different arc segment fit
     // is desired, i.e. least-squares, midpoint on arc, just change the mm_per_arc_segment calculation.
-    // For most uses, this value should not exceed 2000.
-    uint16_t segments =
-        uint16_t(floorf(fabsf(0.5 * angular_travel * radius) / sqrtf(config->_arcTolerance * (2 * radius - config->_arcTolerance))));
-    if (segments) {
-        // Multiply inverse feed_rate to compensate for the fact that this movement is approximated
-        // by a number of discrete segments. The inverse feed_rate should be correct for the sum of
-        // all segments.
-        if (pl_data->motion.inverseTime) {
-            pl_data->feed_rate *= segments;
-            pl_data->motion.inverseTime = 0;  // Force as feed absolute mode over arc segments.
-        }
-        float theta_per_segment = angular_travel / segments;
-        float linear_per_segment[n_axis];
-        linear_per_segment[axis_linear] = (target[axis_linear] - position[axis_linear]) / segments;
-        for (size_t i = A_AXIS; i < n_axis; i++) {
-            linear_per_segment[i] = (target[i] - position[i]) / segments;
+    // Multi-turn helices with a fine tolerance can need more than 65535 segments.
+    uint32_t segments =
+        uint32_t(floorf(fabsf(0.5 * angular_travel * radius) / sqrtf(config->_arcTolerance * (2 * radius - config->_arcTolerance))));
+    if (!segments) {
+        mc_linear(target, pl_data, position);
+        return;
+    }
+
+    // Only the first chord would get the pixels, so the arc runs dark instead
+    if (Raster::reject()) {
+        pl_data->spindle_speed = 0;
+    }
+
+    if (!pl_data->is_jog) {
+        arc_soft_check(target, position, center_axis0, center_axis1, atan2f(r_axis1, r_axis0), angular_travel, axis_0, axis_1, n_axis);
+        if (sys.abort) {
+            return;
         }
-        /* Vector rotation by transformation matrix: r is the original vector, r_T is the rotated vector,
-           and phi is the angle of rotation. Solution approach by Jens Geisler.
-               r_T = [cos(phi) -sin(phi);
-                      sin(phi)  cos(phi] * r ;
-
-           For arc generation, the center of the circle is the axis of rotation and the radius vector is
-           defined from the circle center to the initial position. Each line segment is formed by successive
-           vector rotations. Single precision values can accumulate error greater than tool precision in rare
-           cases. So, exact arc path correction is implemented. This approach avoids the problem of too many very
-           expensive trig operations [sin(),cos(),tan()] which can take 100-200 usec each to compute.
-
-           Small angle approximation may be used to reduce computation overhead further. A third-order approximation
-           (second order sin() has too much error) holds for most, if not, all CNC applications. Note that this
-           approximation will begin to accumulate a numerical drift error when theta_per_segment is greater than
-           ~0.25 rad(14 deg) AND the approximation is successively used without correction several dozen times. This
-           scenario is extremely unlikely, since segment lengths and theta_per_segment are automatically generated
-           and scaled by the arc tolerance setting. Only a very large arc tolerance setting, unrealistic for CNC
-           applications, would cause this numerical drift error. However, it is best to set N_ARC_CORRECTION from a
-           low of ~4 to a high of ~20 or so to avoid trig operations while keeping arc generation accurate.
-
-           This approximation also allows mc_arc to immediately insert a line segment into the planner
-           without the initial overhead of computing cos() or sin(). By the time the arc needs to be applied
-           a correction, the planner should have caught up to the lag caused by the initial mc_arc overhead.
-           This is important when there are successive arc motions.
-        */
-        // Computes: cos_T = 1 - theta_per_segment^2/2, sin_T = theta_per_segment - theta_per_segment^3/6) in ~52usec
-        float cos_T = 2.0f - theta_per_segment * theta_per_segment;
-        float sin_T = theta_per_segment * 0.16666667f * (cos_T + 4.0f);
-        cos_T *= 0.5;
-        float    sin_Ti;
-        float    cos_Ti;
-        float    r_axisi;
-        uint16_t i;
-        size_t   count             = 0;
-        float    original_feedrate = pl_data->feed_rate;  // Kinematics may alter the feedrate, so save an original copy
-        for (i = 1; i < segments; i++) {                  // Increment (segments-1).
+    }
+
+    // Multiply inverse feed_rate to compensate for the fact that this movement is approximated
+    // by a number of discrete segments. The inverse feed_rate should be correct for the sum of
+    // all segments.
+    if (pl_data->motion.inverseTime) {
+        pl_data->feed_rate *= segments;
+        pl_data->motion.inverseTime = 0;  // Force as feed absolute mode over arc segments.
+    }
+    float theta_per_segment = angular_travel / segments;
+    float linear_per_segment[n_axis];
+    linear_per_segment[axis_linear] = (target[axis_linear] - position[axis_linear]) / segments;
+    for (size_t i = A_AXIS; i < n_axis; i++) {
+        linear_per_segment[i] = (target[i] - position[i]) / segments;
+    }
+    /* Vector rotation by transformation matrix: r is the original vector, r_T is the rotated vector,
+       and phi is the angle of rotation. Solution approach by Jens Geisler.
+           r_T = [cos(phi) -sin(phi);
+                  sin(phi)  cos(phi] * r ;
+
+       For arc generation, the center of the circle is the axis of rotation and the radius vector is
+       defined from the circle center to the initial position. Each line segment is formed by successive
+       vector rotations. Single precision values can accumulate error greater than tool precision in rare
+       cases. So, exact arc path correction is implemented. This approach avoids the problem of too many very
+       expensive trig operations [sin(),cos(),tan()] which can take 100-200 usec each to compute.
+
+       Small angle approximation may be used to reduce computation overhead further. A third-order approximation
+       (second order sin() has too much error) holds for most, if not, all CNC applications. Note that this
+       approximation will begin to accumulate a numerical drift error when theta_per_segment is greater than
+       ~0.25 rad(14 deg) AND the approximation is successively used without correction several dozen times. This
+       scenario is extremely unlikely, since segment lengths and theta_per_segment are automatically generated
+       and scaled by the arc tolerance setting. Only a very large arc tolerance setting, unrealistic for CNC
+       applications, would cause this numerical drift error. However, it is best to set N_ARC_CORRECTION from a
+       low of ~4 to a high of ~20 or so to avoid trig operations while keeping arc generation accurate.
+
+       The chord end points are computed a batch at a time, then handed to the kinematics in a tight loop.
+       Soft limits were checked above for the whole arc, so the chords bypass mc_linear().
+    */
+    // Computes: cos_T = 1 - theta_per_segment^2/2, sin_T = theta_per_segment - theta_per_segment^3/6) in ~52usec
+    float cos_T = 2.0f - theta_per_segment * theta_per_segment;
+    float sin_T = theta_per_segment * 0.16666667f * (cos_T + 4.0f);
+    cos_T *= 0.5;
+    float  sin_Ti;
+    float  cos_Ti;
+    float  r_axisi;
+    size_t count             = 0;
+    float  original_feedrate = pl_data->feed_rate;  // Kinematics may alter the feedrate, so save an original copy
+
+    // batch[0] is the start of the first chord in the batch; the other axes never change
+    const size_t arcBatch = N_ARC_CORRECTION + 1;
+    float        batch[arcBatch + 1][n_axis];
+    for (size_t n = 0; n <= arcBatch; n++) {
+        copyAxes(batch[n], position);
+    }
+
+    for (uint32_t i = 1; i < segments;) {  // Increment (segments-1).
+        size_t n = 1;
+        for (; n <= arcBatch && i < segments; n++, i++) {
             if (count < N_ARC_CORRECTION) {
                 // Apply vector rotation matrix. ~40 usec
                 r_axisi = r_axis0 * sin_T + r_axis1 * cos_T;
@@ -232,25 +303,27 @@ void mc_arc(float*            target,
                 count   = 0;
             }
             // Update arc_target location
-            position[axis_0] = center_axis0 + r_axis0;
-            position[axis_1] = center_axis1 + r_axis1;
-            position[axis_linear] += linear_per_segment[axis_linear];
-            for (size_t i = A_AXIS; i < n_axis; i++) {
-                position[i] += linear_per_segment[i];
+            float* arc_target       = batch[n];
+            arc_target[axis_0]      = center_axis0 + r_axis0;
+            arc_target[axis_1]      = center_axis1 + r_axis1;
+            arc_target[axis_linear] = batch[n - 1][axis_linear] + linear_per_segment[axis_linear];
+            for (size_t axis = A_AXIS; axis < n_axis; axis++) {
+                arc_target[axis] = batch[n - 1][axis] + linear_per_segment[axis];
             }
+        }
+        for (size_t k = 1; k < n; k++) {
             pl_data->feed_rate = original_feedrate;  // This restores the feedrate kinematics may have altered
-            mc_linear(position, pl_data, previous_position);
-            previous_position[axis_0]      = position[axis_0];
-            previous_position[axis_1]      = position[axis_1];
-            previous_position[axis_linear] = position[axis_linear];
-            // Bail mid-circle on system abort. Runtime command check already performed by mc_linear.
+            config->_kinematics->cartesian_to_motors(batch[k], pl_data, batch[k - 1]);
+            // Bail mid-circle on system abort. Runtime command check already performed by mc_move_motors.
             if (sys.abort) {
                 return;
             }
         }
+        copyAxes(batch[0], batch[n - 1]);
     }
     // Ensure last segment arrives at target location.
-    mc_linear(target, pl_data, previous_position);
+    config->_kinematics->cartesian_to_motors(target, pl_data, batch[0]);
+    copyAxes(position, batch[0]);
 }
 
 // Execute dwell in seconds.
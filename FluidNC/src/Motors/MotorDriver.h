@@ -26,6 +26,8 @@
 
 #include <cstdint>
 
+class Pin;
+
 namespace MotorDrivers {
     class MotorDriver : public Configuration::Configurable {
     public:
@@ -78,6 +80,13 @@ namespace MotorDrivers {
         // states of the step pins are unknown.
         virtual void unstep();
 
+        // step_dir_pins() returns the step and direction pins of a
+        // motor that is driven only by writing those pins, so that
+        // Machine::StepMap can write them along with the pins of other
+        // motors.  Drivers that need step(), unstep() and
+        // set_direction() to be called return false.
+        virtual bool step_dir_pins(Pin*& step_pin, Pin*& dir_pin) { return false; }
+
         // this is used to configure and test motors. This would be used for Trinamic
         virtual void config_motor() {}
 
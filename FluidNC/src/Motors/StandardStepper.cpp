@@ -116,6 +116,16 @@ namespace MotorDrivers {
 
     void IRAM_ATTR StandardStepper::set_direction(bool dir) { _dir_pin.write(dir); }
 
+    bool StandardStepper::step_dir_pins(Pin*& step_pin, Pin*& dir_pin) {
+        // RMT pulses are started in the peripheral, not by writing the pin
+        if (config->_stepping->_engine == Stepping::RMT) {
+            return false;
+        }
+        step_pin = &_step_pin;
+        dir_pin  = &_dir_pin;
+        return true;
+    }
+
     void IRAM_ATTR StandardStepper::set_disable(bool disable) { _disable_pin.synchronousWrite(disable); }
 
     // Configuration registration
@@ -20,6 +20,7 @@ namespace MotorDrivers {
         void set_direction(bool) override;
         void step() override;
         void unstep() override;
+        bool step_dir_pins(Pin*& step_pin, Pin*& dir_pin) override;
         void read_settings() override;
 
         void init_step_dir_pins();
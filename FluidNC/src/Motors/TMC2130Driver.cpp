@@ -7,6 +7,7 @@
 
 #include "TMC2130Driver.h"
 #include "../Machine/MachineConfig.h"
+#include "Driver/tmc_spi.h"
 #include <atomic>
 
 namespace MotorDrivers {
@@ -25,6 +26,7 @@ namespace MotorDrivers {
     }
 
     void TMC2130Driver::config_motor() {
+        tmc_spi_forget(tmc2130);  // begin() must reach the chip
         tmc2130->begin();
         TrinamicBase::config_motor();
     }
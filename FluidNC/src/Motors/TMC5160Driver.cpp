@@ -3,6 +3,7 @@
 
 #include "TMC5160Driver.h"
 #include "../Machine/MachineConfig.h"
+#include "Driver/tmc_spi.h"
 #include <atomic>
 
 namespace MotorDrivers {
@@ -25,6 +26,7 @@ namespace MotorDrivers {
     }
 
     void TMC5160Driver::config_motor() {
+        tmc_spi_forget(tmc5160);  // begin() must reach the chip
         tmc5160->begin();
         TrinamicBase::config_motor();
     }
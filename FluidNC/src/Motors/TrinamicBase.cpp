@@ -3,6 +3,7 @@
 
 #include "TrinamicBase.h"
 #include "../Machine/MachineConfig.h"
+#include "Driver/tmc_spi.h"  // tmc_spi_snapshot_begin()
 
 #include <atomic>
 
@@ -18,12 +19,23 @@ namespace MotorDrivers {
     // I think that timers are cheap so having only a single timer might not buy us much
     void TrinamicBase::read_sg(TimerHandle_t timer) {
         if (inMotionState()) {
+            bool debugging = false;
+            for (TrinamicBase* t : _instances) {
+                debugging |= t->_stallguardDebugMode;
+            }
+            if (!debugging) {
+                return;
+            }
+
+            // Fetch the status of all the SPI drivers in one pass instead of motor by motor
+            tmc_spi_snapshot_begin();
             for (TrinamicBase* t : _instances) {
                 if (t->_stallguardDebugMode) {
                     //log_info("SG:" << t->_stallguardDebugMode);
                     t->debug_message();
                 }
             }
+            tmc_spi_snapshot_end();
         }
     }
 
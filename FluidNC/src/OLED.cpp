@@ -198,7 +198,7 @@ void OLED::encoder_update(int16_t enc_diff) {
     if ((sys.state == State::Idle) && (jog_state == JogState::Scrolling)) {
 
         // Extract axis from menu item
-        char *axis = (strrchr(_menu->get_selected()->display_name, ' ') + 1);
+        const char *axis = (strrchr(_menu->get_selected()->display_name, ' ') + 1);
 
         // Start timer if not active
         if (!jog_timer_active) {
@@ -309,6 +309,9 @@ void OLED::show_menu() {
         _oled->fillRect(0, _header_height, menu_width, _height);
         _oled->setColor(WHITE);
 
+        // Pick up changes to the SD card files
+        _menu->sync_sd_files();
+
         // Update the menu selection if not jogging
         if (jog_state == JogState::Idle) {
 
@@ -330,7 +333,7 @@ void OLED::show_menu() {
             truncated_draw_string(_header_height + (menu_height * i), entry->display_name, (entry->updated ? DejaVu_Sans_Bold_10 : DejaVu_Sans_10));
 
             // Advance the line and pointer
-            entry = entry->next;
+            entry = _menu->get_next(entry);
             i++;
         }
         _oled->display();
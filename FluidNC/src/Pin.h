@@ -131,6 +131,8 @@ public:
     void write(bool value) const;
     void synchronousWrite(bool value) const;
 
+    inline void disableWriteCache() const { _detail->disableWriteCache(); }
+
     inline bool read() const { return _detail->read() != 0; }
 
     inline void setAttr(Attr attributes) const { _detail->setAttr(attributes); }
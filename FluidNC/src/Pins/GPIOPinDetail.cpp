@@ -193,7 +193,7 @@ namespace Pins {
     PinCapabilities GPIOPinDetail::capabilities() const { return _capabilities; }
 
     void IRAM_ATTR GPIOPinDetail::write(int high) {
-        if (high != _lastWrittenValue) {
+        if (high != _lastWrittenValue || !_writeCache) {
             _lastWrittenValue = high;
             if (!_attributes.has(PinAttributes::Output)) {
                 log_error(toString());
@@ -16,6 +16,7 @@ namespace Pins {
         static std::vector<bool> _claimed;
 
         bool _lastWrittenValue = false;
+        bool _writeCache       = true;
 
     public:
 #ifdef SERAMA
@@ -33,6 +34,8 @@ namespace Pins {
         void          setAttr(PinAttributes value) override;
         PinAttributes getAttr() const override;
 
+        void disableWriteCache() override { _writeCache = false; }
+
         // ISR's:
         void attachInterrupt(void (*callback)(void*), void* arg, int mode) override;
         void detachInterrupt() override;
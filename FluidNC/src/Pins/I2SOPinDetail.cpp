@@ -36,7 +36,7 @@ namespace Pins {
     // The write will not happen immediately; the data is queued for
     // delivery to the serial shift register chain via DMA and a FIFO
     void IRAM_ATTR I2SOPinDetail::write(int high) {
-        if (high != _lastWrittenValue) {
+        if (high != _lastWrittenValue || !_writeCache) {
             _lastWrittenValue = high;
             i2s_out_write(_index, _readWriteMask ^ high);
         }
@@ -44,7 +44,7 @@ namespace Pins {
 
     // Write and wait for completion.  Not suitable for use from an ISR
     void I2SOPinDetail::synchronousWrite(int high) {
-        if (high != _lastWrittenValue) {
+        if (high != _lastWrittenValue || !_writeCache) {
             _lastWrittenValue = high;
 
             i2s_out_write(_index, _readWriteMask ^ high);
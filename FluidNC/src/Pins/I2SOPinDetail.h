@@ -16,6 +16,7 @@ namespace Pins {
         static std::vector<bool> _claimed;
 
         bool _lastWrittenValue = false;
+        bool _writeCache       = true;
 
     public:
         I2SOPinDetail(pinnum_t index, const PinOptionsParser& options);
@@ -29,6 +30,8 @@ namespace Pins {
         void          setAttr(PinAttributes value) override;
         PinAttributes getAttr() const override;
 
+        void disableWriteCache() override { _writeCache = false; }
+
         std::string toString() override;
 
         ~I2SOPinDetail() override { _claimed[_index] = false; }
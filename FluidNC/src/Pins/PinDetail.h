@@ -37,6 +37,10 @@ namespace Pins {
         virtual void          setAttr(PinAttributes value) = 0;
         virtual PinAttributes getAttr() const              = 0;
 
+        // The pin is also written around write(), e.g. by port masks, so
+        // write() must not skip values that it thinks are already there
+        virtual void disableWriteCache() {}
+
         // ISR's.
         virtual void attachInterrupt(void (*callback)(void*), void* arg, int mode);
         virtual void detachInterrupt();
@@ -10,21 +10,62 @@
 
 #include "Planner.h"
 #include "Machine/MachineConfig.h"
+#include "Logging.h"
+#include "MyIOStream.h"
 
 #include <cstdlib>  // PSoc Required for labs
 #include <cmath>
-
-static plan_block_t* block_buffer = nullptr;  // A ring buffer for motion instructions
-static uint8_t       block_buffer_tail;       // Index of the block to process now
-static uint8_t       block_buffer_head;       // Index of the next block to be pushed
-static uint8_t       next_buffer_head;        // Index of the next buffer head
-static uint8_t       block_buffer_planned;    // Index of the optimally planned block
+#include <esp_heap_caps.h>
+#include <esp_attr.h>  // IRAM_ATTR
+
+static plan_block_t*   block_buffer  = nullptr;  // A ring buffer for motion instructions
+static plan_profile_t* block_profile = nullptr;  // Acceleration profiles, indexed like block_buffer
+static uint16_t        block_buffer_tail;        // Index of the block to process now
+static uint16_t        block_buffer_head;        // Index of the next block to be pushed
+static uint16_t        next_buffer_head;         // Index of the next buffer head
+static uint16_t        block_buffer_planned;     // Index of the optimally planned block
+
+// Work done by planner_recalculate(), for tuning planner_horizon
+static struct {
+    uint32_t calls;
+    uint64_t visited;  // Blocks visited by both passes
+    uint32_t max_visited;
+    uint32_t early_stops;    // Reverse passes that stopped at an unchanged block
+    uint32_t horizon_stops;  // Reverse passes cut short by planner_horizon
+} recalcStats;
 
 void plan_init() {
     if (block_buffer) {
-        delete[] block_buffer;
+        heap_caps_free(block_buffer);
+        block_buffer = nullptr;
+    }
+    if (block_profile) {
+        heap_caps_free(block_profile);
+        block_profile = nullptr;
+    }
+    // Deep look-ahead buffers can be placed in PSRAM, since the planner
+    // blocks are only accessed from tasks, never from the stepper ISR.
+    size_t bytes = config->_planner_blocks * sizeof(plan_block_t);
+    if (config->_planner_psram) {
+        block_buffer = static_cast<plan_block_t*>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (!block_buffer) {
+            log_warn("No PSRAM for " << config->_planner_blocks << " planner blocks; using internal RAM");
+        }
+    }
+    while (!block_buffer) {
+        block_buffer = static_cast<plan_block_t*>(heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+        if (!block_buffer) {
+            // Fall back to a shallower buffer rather than failing to start
+            Assert(config->_planner_blocks > 10, "Cannot allocate planner blocks");
+            config->_planner_blocks /= 2;
+            bytes = config->_planner_blocks * sizeof(plan_block_t);
+            log_error("Not enough memory for planner; reduced to " << config->_planner_blocks << " blocks");
+        }
     }
-    block_buffer = new plan_block_t[config->_planner_blocks];
+    // The profiles are what planner_recalculate() walks, so they always stay in internal RAM
+    block_profile = static_cast<plan_profile_t*>(
+        heap_caps_malloc(config->_planner_blocks * sizeof(plan_profile_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    Assert(block_profile, "Cannot allocate planner profiles");
 }
 
 // Define planner variables
@@ -38,7 +79,7 @@ typedef struct {
 static planner_t pl;
 
 // Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
-static uint8_t plan_next_block_index(uint8_t block_index) {
+static uint16_t plan_next_block_index(uint16_t block_index) {
     block_index++;
     if (block_index == config->_planner_blocks) {
         block_index = 0;
@@ -47,7 +88,7 @@ static uint8_t plan_next_block_index(uint8_t block_index) {
 }
 
 // Returns the index of the previous block in the ring buffer
-static uint8_t plan_prev_block_index(uint8_t block_index) {
+static uint16_t plan_prev_block_index(uint16_t block_index) {
     if (block_index == 0) {
         block_index = config->_planner_blocks;
     }
@@ -120,22 +161,32 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
   ARM versions should have enough memory and speed for look-ahead blocks numbering up to a hundred or more.
 
 */
-static void planner_recalculate() {
+// A new block only changes the plan from the back of the buffer, so the passes can stop where
+// the plan stops changing.  After plan_cycle_reinitialize() the tail's entry speed and the
+// junction limits have changed, so every block from the planned pointer is replanned.
+static void planner_recalculate(bool newBlock) {
     // Initialize block index to the last block in the planner buffer.
-    uint8_t block_index = plan_prev_block_index(block_buffer_head);
+    uint16_t block_index = plan_prev_block_index(block_buffer_head);
     // Bail. Can't do anything with one only one plan-able block.
     if (block_index == block_buffer_planned) {
         return;
     }
+    ++recalcStats.calls;
+    uint32_t visited = 1;
+
     // Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from the last
     // block in buffer. Cease planning when the last optimal planned or tail pointer is reached.
     // NOTE: Forward pass will later refine and correct the reverse pass to create an optimal plan.
-    float         entry_speed_sqr;
-    plan_block_t* next;
-    plan_block_t* current = &block_buffer[block_index];
+    float           entry_speed_sqr;
+    plan_profile_t* next;
+    plan_profile_t* current = &block_profile[block_index];
     // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
     current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, 2 * current->acceleration * current->millimeters);
     block_index              = plan_prev_block_index(block_index);
+    // Blocks before forward_start are unchanged since the last recalculation, so the forward
+    // pass does not need to revisit them.
+    uint16_t forward_start = block_buffer_planned;
+    size_t   horizon       = newBlock ? config->_planner_horizon : 0;
     if (block_index == block_buffer_planned) {  // Only two plannable blocks in buffer. Reverse pass complete.
         // Check if the first block is the tail. If so, notify stepper to update its current parameters.
         if (block_index == block_buffer_tail) {
@@ -143,14 +194,17 @@ static void planner_recalculate() {
         }
     } else {  // Three or more plan-able blocks
         while (block_index != block_buffer_planned) {
-            next        = current;
-            current     = &block_buffer[block_index];
-            block_index = plan_prev_block_index(block_index);
+            uint16_t current_index = block_index;
+            next                   = current;
+            current                = &block_profile[block_index];
+            block_index            = plan_prev_block_index(block_index);
+            ++visited;
             // Check if next block is the tail block(=planned block). If so, update current stepper parameters.
             if (block_index == block_buffer_tail) {
                 Stepper::update_plan_block_parameters();
             }
             // Compute maximum entry speed decelerating over the current block from its exit speed.
+            float old_entry_speed_sqr = current->entry_speed_sqr;
             if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
                 entry_speed_sqr = next->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
                 if (entry_speed_sqr < current->max_entry_speed_sqr) {
@@ -159,15 +213,31 @@ static void planner_recalculate() {
                     current->entry_speed_sqr = current->max_entry_speed_sqr;
                 }
             }
+            // Every block before this one was planned from the same exit speed last time,
+            // so the rest of the reverse pass would not change anything.
+            if (newBlock && current->entry_speed_sqr == old_entry_speed_sqr) {
+                forward_start = current_index;
+                ++recalcStats.early_stops;
+                break;
+            }
+            // With a horizon, older blocks keep their lower entry speeds.  That plan is still
+            // feasible - the forward pass, starting from the untouched previous block, limits
+            // the acceleration into this one - just not optimal.
+            if (horizon && visited >= horizon) {
+                forward_start = block_index;
+                ++recalcStats.horizon_stops;
+                break;
+            }
         }
     }
     // Forward Pass: Forward plan the acceleration curve from the planned pointer onward.
     // Also scans for optimal plan breakpoints and appropriately updates the planned pointer.
-    next        = &block_buffer[block_buffer_planned];  // Begin at buffer planned pointer
-    block_index = plan_next_block_index(block_buffer_planned);
+    next        = &block_profile[forward_start];  // Begin at buffer planned pointer
+    block_index = plan_next_block_index(forward_start);
     while (block_index != block_buffer_head) {
+        ++visited;
         current = next;
-        next    = &block_buffer[block_index];
+        next    = &block_profile[block_index];
         // Any acceleration detected in the forward pass automatically moves the optimal planned
         // pointer forward, since everything before this is all optimal. In other words, nothing
         // can improve the plan from the buffer tail to the planned pointer by logic.
@@ -188,6 +258,22 @@ static void planner_recalculate() {
         }
         block_index = plan_next_block_index(block_index);
     }
+    recalcStats.visited += visited;
+    if (visited > recalcStats.max_visited) {
+        recalcStats.max_visited = visited;
+    }
+}
+
+void plan_report_stats(Print& out) {
+    out << "calls=" << recalcStats.calls << " visited=" << recalcStats.visited << " max=" << recalcStats.max_visited
+        << " early=" << recalcStats.early_stops << " horizon=" << recalcStats.horizon_stops;
+    if (recalcStats.calls) {
+        out << " avg=" << float(recalcStats.visited) / recalcStats.calls;
+    }
+}
+
+void plan_reset_stats() {
+    recalcStats = {};
 }
 
 void plan_reset() {
@@ -205,7 +291,7 @@ void plan_reset_buffer() {
 // Called from stepper pulse function when the block is complete
 void plan_discard_current_block() {
     if (block_buffer_head != block_buffer_tail) {  // Discard non-empty buffer.
-        uint8_t block_index = plan_next_block_index(block_buffer_tail);
+        uint16_t block_index = plan_next_block_index(block_buffer_tail);
         // Push block_buffer_planned pointer, if encountered.
         if (block_buffer_tail == block_buffer_planned) {
             block_buffer_planned = block_index;
@@ -227,12 +313,21 @@ plan_block_t* plan_get_current_block() {
     return &block_buffer[block_buffer_tail];
 }
 
+// Like plan_get_current_block() == NULL, but safe to call from the stepper ISR
+bool IRAM_ATTR plan_buffer_empty() {
+    return block_buffer_head == block_buffer_tail;
+}
+
+plan_profile_t* plan_get_profile(const plan_block_t* block) {
+    return &block_profile[block - block_buffer];
+}
+
 float plan_get_exec_block_exit_speed_sqr() {
-    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    uint16_t block_index = plan_next_block_index(block_buffer_tail);
     if (block_index == block_buffer_head) {
         return 0.0f;
     }
-    return block_buffer[block_index].entry_speed_sqr;
+    return block_profile[block_index].entry_speed_sqr;
 }
 
 // Returns the availability status of the block ring buffer. True, if full.
@@ -242,7 +337,7 @@ uint8_t plan_check_full_buffer() {
 
 // Computes and returns block nominal speed based on running condition and override values.
 // NOTE: All system motion commands, such as homing/parking, are not subject to overrides.
-float plan_compute_profile_nominal_speed(plan_block_t* block) {
+float plan_compute_profile_nominal_speed(const plan_block_t* block) {
     float nominal_speed = block->programmed_rate;
     if (block->motion.rapidMotion) {
         nominal_speed *= (0.01f * sys.r_override);
@@ -262,29 +357,32 @@ float plan_compute_profile_nominal_speed(plan_block_t* block) {
 
 // Computes and updates the max entry speed (sqr) of the block, based on the minimum of the junction's
 // previous and current nominal speeds and max junction speed.
-static void plan_compute_profile_parameters(plan_block_t* block, float nominal_speed, float prev_nominal_speed) {
+static void plan_compute_profile_parameters(const plan_block_t* block,
+                                            plan_profile_t*     profile,
+                                            float               nominal_speed,
+                                            float               prev_nominal_speed) {
     // Compute the junction maximum entry based on the minimum of the junction speed and neighboring nominal speeds.
     if (nominal_speed > prev_nominal_speed) {
-        block->max_entry_speed_sqr = prev_nominal_speed * prev_nominal_speed;
+        profile->max_entry_speed_sqr = prev_nominal_speed * prev_nominal_speed;
     } else {
-        block->max_entry_speed_sqr = nominal_speed * nominal_speed;
+        profile->max_entry_speed_sqr = nominal_speed * nominal_speed;
     }
 
-    if (block->max_entry_speed_sqr > block->max_junction_speed_sqr) {
-        block->max_entry_speed_sqr = block->max_junction_speed_sqr;
+    if (profile->max_entry_speed_sqr > block->max_junction_speed_sqr) {
+        profile->max_entry_speed_sqr = block->max_junction_speed_sqr;
     }
 }
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters() {
-    uint8_t       block_index = block_buffer_tail;
+    uint16_t      block_index = block_buffer_tail;
     plan_block_t* block;
     float         nominal_speed;
     float         prev_nominal_speed = SOME_LARGE_VALUE;  // Set high for first block nominal speed calculation.
     while (block_index != block_buffer_head) {
         block         = &block_buffer[block_index];
         nominal_speed = plan_compute_profile_nominal_speed(block);
-        plan_compute_profile_parameters(block, nominal_speed, prev_nominal_speed);
+        plan_compute_profile_parameters(block, &block_profile[block_index], nominal_speed, prev_nominal_speed);
         prev_nominal_speed = nominal_speed;
         block_index        = plan_next_block_index(block_index);
     }
@@ -293,8 +391,10 @@ void plan_update_velocity_profile_parameters() {
 
 bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     // Prepare and initialize new block. Copy relevant pl_data for block execution.
-    plan_block_t* block = &block_buffer[block_buffer_head];
-    memset(block, 0, sizeof(plan_block_t));  // Zero all block values.
+    plan_block_t*   block   = &block_buffer[block_buffer_head];
+    plan_profile_t* profile = &block_profile[block_buffer_head];
+    memset(block, 0, sizeof(plan_block_t));      // Zero all block values.
+    memset(profile, 0, sizeof(plan_profile_t));  // Zero all profile values.
     block->motion        = pl_data->motion;
     block->coolant       = pl_data->coolant;
     block->spindle       = pl_data->spindle;
@@ -332,23 +432,23 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     // down such that no individual axes maximum values are exceeded with respect to the line direction.
     // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
     // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
-    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
-    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec, block->motion.rapidMotion);
-    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+    profile->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
+    profile->acceleration = limit_acceleration_by_axis_maximum(unit_vec, block->motion.rapidMotion);
+    block->rapid_rate     = limit_rate_by_axis_maximum(unit_vec);
     // Store programmed rate.
     if (block->motion.rapidMotion) {
         block->programmed_rate = block->rapid_rate;
     } else {
         block->programmed_rate = pl_data->feed_rate;
         if (block->motion.inverseTime) {
-            block->programmed_rate *= block->millimeters;
+            block->programmed_rate *= profile->millimeters;
         }
     }
     // TODO: Need to check this method handling zero junction speeds when starting from rest.
     if ((block_buffer_head == block_buffer_tail) || (block->motion.systemMotion)) {
         // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
         // If system motion, the system motion block always is assumed to start from rest and end at a complete stop.
-        block->entry_speed_sqr        = 0.0;
+        profile->entry_speed_sqr      = 0.0;
         block->max_junction_speed_sqr = 0.0;  // Starting from rest. Enforce start from zero velocity.
     } else {
         // Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
@@ -398,8 +498,13 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     }
     // Block system motion from updating this data to ensure next g-code motion is computed correctly.
     if (!(block->motion.systemMotion)) {
+        if (!block->motion.rapidMotion && !block->is_jog) {
+            if (!Raster::attach(block->raster, block->step_event_count)) {
+                block->spindle_speed = 0;  // Never burn a dropped line at the full S value
+            }
+        }
         float nominal_speed = plan_compute_profile_nominal_speed(block);
-        plan_compute_profile_parameters(block, nominal_speed, pl.previous_nominal_speed);
+        plan_compute_profile_parameters(block, profile, nominal_speed, pl.previous_nominal_speed);
         pl.previous_nominal_speed = nominal_speed;
         // Update previous path unit_vector and planner position.
         copyAxes(pl.previous_unit_vec, unit_vec);
@@ -408,7 +513,7 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         block_buffer_head = next_buffer_head;
         next_buffer_head  = plan_next_block_index(block_buffer_head);
         // Finish up by recalculating the plan with the new block.
-        planner_recalculate();
+        planner_recalculate(true);
     }
     return true;
 }
@@ -424,7 +529,7 @@ void plan_sync_position() {
 
 // Returns the number of available blocks are in the planner buffer.
 // Called from report_realtime_status
-uint8_t plan_get_block_buffer_available() {
+uint16_t plan_get_block_buffer_available() {
     if (block_buffer_head >= block_buffer_tail) {
         return (config->_planner_blocks - 1) - (block_buffer_head - block_buffer_tail);
     } else {
@@ -438,5 +543,5 @@ void plan_cycle_reinitialize() {
     // Re-plan from a complete stop. Reset planner entry speeds and buffer planned pointer.
     Stepper::update_plan_block_parameters();
     block_buffer_planned = block_buffer_tail;
-    planner_recalculate();
+    planner_recalculate(false);
 }
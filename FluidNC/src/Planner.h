@@ -12,9 +12,12 @@
 #include "Config.h"            // MAX_N_AXIS
 #include "SpindleDatatypes.h"  // SpindleState
 #include "GCode.h"             // CoolantState
+#include "Raster.h"            // Raster::Span
 
 #include <cstdint>
 
+class Print;
+
 // Define planner data condition flags. Used to denote running conditions of a block.
 struct PlMotion {
     uint8_t rapidMotion : 1;
@@ -23,8 +26,22 @@ struct PlMotion {
     uint8_t inverseTime : 1;     // Interprets feed rate value as inverse time when set.
 };
 
+// Fields used by the planner to manage acceleration. Some of these values may be updated
+// by the stepper module during execution of special motion cases for replanning purposes.
+// They are kept in an array of their own, parallel to the planner blocks, so the
+// recalculation passes walk 16 bytes per block instead of the whole plan_block_t.
+struct plan_profile_t {
+    float entry_speed_sqr;      // The current planned entry speed at block junction in (mm/min)^2
+    float max_entry_speed_sqr;  // Maximum allowable entry speed based on the minimum of junction limit and
+    //   neighboring nominal speeds with overrides in (mm/min)^2
+    float acceleration;  // Axis-limit adjusted line acceleration in (mm/min^2). Does not change.
+    float millimeters;   // The remaining distance for this block to be executed in (mm).
+    // NOTE: This value may be altered by stepper algorithm during execution.
+};
+
 // This struct stores a linear movement of a g-code block motion with its critical "nominal" values
-// are as specified in the source g-code.
+// are as specified in the source g-code.  Fields read by the segment generator come first,
+// followed by those only needed when the block is planned or reported.
 struct plan_block_t {
     // Fields used by the bresenham algorithm for tracing the line
     // NOTE: Used by stepper algorithm to execute the block correctly. Do not alter these values.
@@ -34,28 +51,23 @@ struct plan_block_t {
     uint8_t  direction_bits;     // The direction bit set for this block (refers to *_DIRECTION_BIT in config.h)
 
     // Block condition data to ensure correct execution depending on states and overrides.
-    PlMotion     motion;       // Block bitflag motion conditions. Copied from pl_line_data.
-    SpindleState spindle;      // Spindle enable state
-    CoolantState coolant;      // Coolant state
-    int32_t      line_number;  // Block line number for real-time reporting. Copied from pl_line_data.
+    PlMotion     motion;   // Block bitflag motion conditions. Copied from pl_line_data.
+    SpindleState spindle;  // Spindle enable state
 
-    // Fields used by the motion planner to manage acceleration. Some of these values may be updated
-    // by the stepper module during execution of special motion cases for replanning purposes.
-    float entry_speed_sqr;      // The current planned entry speed at block junction in (mm/min)^2
-    float max_entry_speed_sqr;  // Maximum allowable entry speed based on the minimum of junction limit and
-    //   neighboring nominal speeds with overrides in (mm/min)^2
-    float acceleration;  // Axis-limit adjusted line acceleration in (mm/min^2). Does not change.
-    float millimeters;   // The remaining distance for this block to be executed in (mm).
-    // NOTE: This value may be altered by stepper algorithm during execution.
-
-    // Stored rate limiting data used by planner when changes occur.
-    float max_junction_speed_sqr;  // Junction entry speed limit based on direction vectors in (mm/min)^2
-    float rapid_rate;              // Axis-limit adjusted maximum rate for this block direction in (mm/min)
-    float programmed_rate;         // Programmed rate of this block (mm/min).
+    // Stored rate limiting data, used by the segment generator to compute the nominal speed.
+    float rapid_rate;       // Axis-limit adjusted maximum rate for this block direction in (mm/min)
+    float programmed_rate;  // Programmed rate of this block (mm/min).
 
     // Stored spindle speed data used by spindle overrides and resuming methods.
     SpindleSpeed spindle_speed;  // Block spindle speed. Copied from pl_line_data.
 
+    Raster::Span raster;  // Per-step laser power, if any
+
+    // Used by the planner when overrides change, and for reporting.
+    float        max_junction_speed_sqr;  // Junction entry speed limit based on direction vectors in (mm/min)^2
+    CoolantState coolant;                 // Coolant state
+    int32_t      line_number;             // Block line number for real-time reporting. Copied from pl_line_data.
+
     bool is_jog;
 };
 
@@ -92,14 +104,20 @@ plan_block_t* plan_get_system_motion_block();
 // Gets the current block. Returns NULL if buffer empty
 plan_block_t* plan_get_current_block();
 
+// Returns true if no blocks are waiting to be executed
+bool plan_buffer_empty();
+
+// Gets the acceleration profile of a block returned by the functions above
+plan_profile_t* plan_get_profile(const plan_block_t* block);
+
 // Increment block index with wrap-around
-static uint8_t plan_next_block_index(uint8_t block_index);
+static uint16_t plan_next_block_index(uint16_t block_index);
 
 // Called by step segment buffer when computing executing block velocity profile.
 float plan_get_exec_block_exit_speed_sqr();
 
 // Called by main program during planner calculations and step segment buffer during initialization.
-float plan_compute_profile_nominal_speed(plan_block_t* block);
+float plan_compute_profile_nominal_speed(const plan_block_t* block);
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters();
@@ -111,9 +129,14 @@ void plan_sync_position();
 void plan_cycle_reinitialize();
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available();
+uint16_t plan_get_block_buffer_available();
 
 // Returns the status of the block ring buffer. True, if buffer is full.
 uint8_t plan_check_full_buffer();
 
+// Reports the counts of blocks visited by each recalculation; they are
+// cleared by plan_reset_stats()
+void plan_report_stats(Print& out);
+void plan_reset_stats();
+
 void plan_get_planner_mpos(float* target);
@@ -26,6 +26,12 @@
 
 #include "FluidPath.h"
 #include "HashFS.h"
+#include "StepTrace.h"
+#include "Raster.h"
+#include "Planner.h"  // plan_report_stats()
+#include "FilePrefetch.h"
+#include "UploadWriter.h"
+#include "List.h"  // List::stats()
 
 #include <cstring>
 #include <map>
@@ -759,6 +765,67 @@ static Error setReportInterval(const char* value, WebUI::AuthenticationLevel aut
 
 static Error showHeap(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
     log_info("Heap free: " << xPortGetFreeHeapSize() << " min: " << heapLowWater);
+
+    // Menu and RSS lists, with what they would take as one malloc'd node per entry
+    auto lists = List::stats();
+    log_info("Lists: nodes=" << lists.nodes << " arena=" << lists.arenaBytes << " legacy=" << lists.legacyBytes);
+    return Error::Ok;
+}
+
+static Error showPlannerStats(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (value && strcasecmp(value, "reset") == 0) {
+        plan_reset_stats();
+        return Error::Ok;
+    }
+    LogStream msg(out, "[PLANNER:");
+    plan_report_stats(msg);
+    return Error::Ok;
+}
+
+static Error stepTrace(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (!value || !*value) {
+        StepTrace::report(out);
+        return Error::Ok;
+    }
+    if (strcasecmp(value, "on") == 0) {
+        StepTrace::start();
+        return Error::Ok;
+    }
+    if (strcasecmp(value, "off") == 0) {
+        StepTrace::stop();
+        return Error::Ok;
+    }
+    if (strcasecmp(value, "reset") == 0) {
+        StepTrace::reset();
+        return Error::Ok;
+    }
+    // Anything else is the name of a file for the raw trace
+    return StepTrace::save(value, out);
+}
+
+// Appends base64 pixel powers to the line for the next G1 move; no value drops the line
+static Error laserRaster(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (!value || !*value) {
+        Raster::clear();
+        return Error::Ok;
+    }
+    return Raster::append(value);
+}
+
+static Error showSDStats(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (config->_sdCard) {
+        config->_sdCard->report_stats(out);
+    }
+    return Error::Ok;
+}
+
+static Error showUploadStats(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    UploadWriter::report_stats(out);
+    return Error::Ok;
+}
+
+static Error showPrefetchStats(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    FilePrefetch::report_stats(out);
     return Error::Ok;
 }
 
@@ -812,6 +879,12 @@ void make_user_commands() {
     new UserCommand("RST", "Settings/Restore", restore_settings, notIdleOrAlarm, WA);
 
     new UserCommand("Heap", "Heap/Show", showHeap, anyState);
+    new UserCommand("SDP", "SD/PrefetchStats", showPrefetchStats, anyState);
+    new UserCommand("SDM", "SD/MountStats", showSDStats, anyState);
+    new UserCommand("UPS", "Upload/Stats", showUploadStats, anyState);
+    new UserCommand("PLS", "Planner/Stats", showPlannerStats, anyState);
+    new UserCommand("STT", "Stepping/Trace", stepTrace, anyState);
+    new UserCommand("LR", "Laser/Raster", laserRaster, anyState);
     new UserCommand("SS", "Startup/Show", showStartupLog, anyState);
 
     new UserCommand("RI", "Report/Interval", setReportInterval, anyState);
@@ -1029,7 +1102,7 @@ Error execute_line(char* line, Channel& channel, WebUI::AuthenticationLevel auth
         return Error::SystemGcLock;
     }
     Error result = gc_execute_line(line);
-    if (result != Error::Ok) {
+    if (result != Error::Ok && line[0] != TOKENIZED_LINE) {
         log_debug_to(channel, "Bad GCode: " << line);
     }
     return result;
@@ -19,6 +19,10 @@
 #include "Settings.h"       // settings_execute_startup
 #include "Machine/LimitPin.h"
 #include "WebUI/RSSReader.h"
+#include "MessageRing.h"
+
+#include <cstdio>
+#include <cstring>
 
 volatile ExecAlarm rtAlarm;  // Global realtime executor bitflag variable for setting various alarms.
 
@@ -90,90 +94,84 @@ static void request_safety_door() {
 
 TaskHandle_t outputTask = nullptr;
 
-xQueueHandle message_queue;
-
-struct LogMessage {
-    Channel* channel;
-    void*    line;
-    bool     isString;
-};
+// Outgoing lines are copied into a preallocated ring, tagged with their
+// channel, and sent by the output task, which sleeps until a line arrives.
+static const uint32_t messageRingSize = 4096;
+static MessageRing    messageRing(messageRingSize);
 
 void drain_messages() {
-    while (uxQueueMessagesWaiting(message_queue)) {
+    while (!messageRing.empty()) {
         vTaskDelay(1);  // Let the output task finish sending data
     }
 }
 
+// All of the send_line() overloads end up here.  The line need
+// not be NUL-terminated.  It is copied, so the caller's storage
+// can be reused immediately.  A line too long for the ring is
+// replaced by an overflow error rather than sent truncated.
+void send_line(Channel& channel, const char* line, size_t len) {
+    if (!outputTask) {
+        channel.write((const uint8_t*)line, len);
+        channel.println();
+        return;
+    }
+    char overflow[80];
+    if (len > messageRing.max_length()) {
+        len  = snprintf(overflow, sizeof(overflow), "[MSG:ERR: %s, %u bytes not sent]", errorString(Error::Overflow), unsigned(len));
+        line = overflow;
+    }
+    while (!messageRing.put(&channel, line, len)) {
+        if (xTaskGetCurrentTaskHandle() == outputTask) {
+            // The output task cannot wait for itself to make room
+            channel.write((const uint8_t*)line, len);
+            channel.println();
+            return;
+        }
+        vTaskDelay(1);  // The ring is full; let the output task catch up
+    }
+    xTaskNotifyGive(outputTask);
+}
+
 // This overload is used primarily with fixed string
-// values.  It sends a pointer to the string whose
-// memory does not need to be reclaimed later.
-// This is the most efficient form, but it only works
-// with fixed messages.
+// values such as "ok", the most common message.
 void send_line(Channel& channel, const char* line) {
-    if (outputTask) {
-        LogMessage msg { &channel, (void*)line, false };
-        while (!xQueueSend(message_queue, &msg, 10)) {}
-    } else {
-        channel.println(line);
-    }
+    send_line(channel, line, strlen(line));
 }
 
-// This overload is used primarily with log_*() where
-// a std::string is dynamically allocated with "new",
-// and then extended to construct the message.  Its
-// pointer is sent to the output task, which sends
-// the message to the output channel and then "delete"s
-// the pointer to reclaim the memory.
-// This form has intermediate efficiency, as the string
-// is allocated once and freed once.
+// This overload takes ownership of a dynamically allocated
+// string, which is freed as soon as it has been copied.
 void send_line(Channel& channel, const std::string* line) {
-    if (outputTask) {
-        LogMessage msg { &channel, (void*)line, true };
-        while (!xQueueSend(message_queue, &msg, 10)) {}
-    } else {
-        channel.println(line->c_str());
-        delete line;
-    }
+    send_line(channel, line->c_str(), line->length());
+    delete line;
 }
 
 // This overload is used for many miscellaneous messages
-// where the std::string is allocated in a code block and
-// then extended with various information.  This send_line()
-// copies that string to a newly allocated one and sends that
-// via the std::string* version of send_line().  The original
-// string is freed by the caller sometime after send_line()
-// returns, while the new string is freed by the output task
-// after the message is forwared to the output channel.
-// This is the least efficient form, requiring two strings
-// to be allocated and freed, with an intermediate copy.
-// It is used only rarely.
+// where the std::string is built in a code block and
+// then extended with various information.
 void send_line(Channel& channel, const std::string& line) {
-    if (outputTask) {
-        send_line(channel, new std::string(line));
-    } else {
-        channel.println(line.c_str());
-    }
+    send_line(channel, line.c_str(), line.length());
 }
 
 void output_loop(void* unused) {
 #ifdef DEBUG_MEMORY_WATERMARKS
-    uint32_t start_time = millis();
+    uint32_t         start_time = millis();
+    const TickType_t waitTicks  = pdMS_TO_TICKS(DEBUG_MEMORY_WM_TIME_MS);
+#else
+    const TickType_t waitTicks = portMAX_DELAY;
 #endif
     while (true) {
-        LogMessage message;
-        if (xQueueReceive(message_queue, &message, 0)) {
-            if (message.channel) {
-                if (message.isString) {
-                    std::string* s = static_cast<std::string*>(message.line);
-                    if (s) message.channel->println(s->c_str());
-                    delete s;
-                } else {
-                    const char* cp = static_cast<const char*>(message.line);
-                    if (cp) message.channel->println(cp);
-                }
+        Channel*    channel;
+        const char* line;
+        if (messageRing.peek(channel, line)) {
+            if (channel) {
+                channel->println(line);
             }
+            messageRing.release();
+        } else {
+            // Senders notify after each line, so a line that arrives
+            // between peek() and here is not missed.
+            ulTaskNotifyTake(pdTRUE, waitTicks);
         }
-        vTaskDelay(0);
 #ifdef DEBUG_MEMORY_WATERMARKS
         if (millis() - start_time >= DEBUG_MEMORY_WM_TIME_MS) {
             log_warn("output_loop watermark -> " << uxTaskGetStackHighWaterMark(NULL));
@@ -206,6 +204,11 @@ void polling_loop(void* unused) {
         // Read ultrasonic sensor
         protocol_read_ultrasonic();
 
+        // Unmount an idle SD card
+        if (config->_sdCard) {
+            config->_sdCard->poll();
+        }
+
         if (activeChannel) {
             // Poll for realtime characters when waiting for the primary loop
             // (in another thread) to pick up the line.
@@ -1216,7 +1219,7 @@ static void protocol_do_enter() {
 
                     } else {
 
-                        InputFile *infile = new InputFile("sd", config->_oled->_menu->get_selected()->path, WebUI::AuthenticationLevel::LEVEL_ADMIN, allChannels);
+                        InputFile *infile = InputFile::open("sd", config->_oled->_menu->get_selected()->path, WebUI::AuthenticationLevel::LEVEL_ADMIN, allChannels);
                         allChannels.registration(infile);
                     }
 
@@ -1336,8 +1339,7 @@ NoArgEvent resetEvent { mc_reset };
 xQueueHandle event_queue;
 
 void protocol_init() {
-    event_queue   = xQueueCreate(10, sizeof(EventItem));
-    message_queue = xQueueCreate(10, sizeof(LogMessage));
+    event_queue = xQueueCreate(10, sizeof(EventItem));
 }
 
 void IRAM_ATTR protocol_send_event_from_ISR(Event* evt, void* arg) {
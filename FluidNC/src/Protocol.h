@@ -130,6 +130,7 @@ void protocol_send_event_from_ISR(Event* evt, void* arg = 0);
 void send_line(Channel& channel, const char* message);
 void send_line(Channel& channel, const std::string* message);
 void send_line(Channel& channel, const std::string& message);
+void send_line(Channel& channel, const char* message, size_t len);
 
 void drain_messages();
 
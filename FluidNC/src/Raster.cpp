@@ -0,0 +1,162 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Raster.h"
+
+#include "Planner.h"  // plan_buffer_empty()
+#include "System.h"   // sys.state
+#include "Logging.h"
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstring>
+
+namespace Raster {
+    static uint8_t* pool    = nullptr;
+    static uint8_t* pending = nullptr;
+    static uint32_t nPending;
+
+    // Spans occupy [tail, head), possibly wrapping; head == tail when empty.
+    // Spans themselves never wrap, so the end of the pool may be skipped.
+    static uint32_t          head;
+    static volatile uint32_t tail;  // Advanced by the stepper ISR
+    static uint8_t  gen;
+
+    static int base64_value(char c) {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        if (c == '+') {
+            return 62;
+        }
+        if (c == '/') {
+            return 63;
+        }
+        return -1;
+    }
+
+    Error append(const char* base64) {
+        if (!pool) {
+            pool    = new uint8_t[poolSize];
+            pending = new uint8_t[maxPending];
+        }
+        uint32_t bits  = 0;
+        int      nBits = 0;
+        uint32_t n     = nPending;
+        for (const char* p = base64; *p && *p != '='; ++p) {
+            int value = base64_value(*p);
+            if (value < 0) {
+                log_error("Bad character in raster data");
+                return Error::InvalidValue;
+            }
+            bits = (bits << 6) | value;
+            nBits += 6;
+            if (nBits >= 8) {
+                nBits -= 8;
+                if (n == maxPending) {
+                    log_error("Raster line is longer than " << int(maxPending) << " pixels");
+                    return Error::Overflow;
+                }
+                pending[n++] = uint8_t(bits >> nBits);
+            }
+        }
+        nPending = n;
+        return Error::Ok;
+    }
+
+    void clear() { nPending = 0; }
+
+    // Finds room for n pixels, returning false if the pool is too full
+    static bool find(uint32_t n, uint32_t& start) {
+        uint32_t t = tail;
+        if (head == t) {
+            // Empty, so the ISR has no span left to start
+            head = tail = t = 0;
+        }
+        if (head >= t) {
+            // Keep head below poolSize unless it can wrap without meeting tail
+            if (head + n < poolSize || (head + n == poolSize && t > 0)) {
+                start = head;
+                return true;
+            }
+            if (n < t) {
+                start = 0;
+                return true;
+            }
+            return false;
+        }
+        if (head + n < t) {
+            start = head;
+            return true;
+        }
+        return false;
+    }
+
+    bool waiting() {
+        if (!nPending) {
+            return false;
+        }
+        uint32_t start;
+        if (find(nPending, start)) {
+            return false;
+        }
+        if (sys.state == State::Idle && plan_buffer_empty()) {
+            // Nothing queued or executing, so every span is stale
+            head = tail = 0;
+            ++gen;
+            return false;
+        }
+        return true;
+    }
+
+    bool attach(Span& span, uint32_t stepEvents) {
+        span = {};
+        if (!nPending) {
+            return true;
+        }
+        uint32_t start;
+        bool     attached = false;
+        if (nPending > stepEvents) {
+            log_error("Raster line has " << int(nPending) << " pixels but its move only " << int(stepEvents) << " steps; laser off");
+        } else if (!find(nPending, start)) {
+            log_error("Raster pool is full; laser off");
+        } else {
+            memcpy(pool + start, pending, nPending);
+            head       = (start + nPending) % poolSize;
+            span.start = start;
+            span.count = nPending;
+            span.gen   = gen;
+            attached   = true;
+        }
+        nPending = 0;
+        return attached;
+    }
+
+    bool reject() {
+        if (!nPending) {
+            return false;
+        }
+        log_error("Raster lines need a straight move that is planned as one block; laser off");
+        nPending = 0;
+        return true;
+    }
+
+    const uint8_t* pixels(const Span& span) { return pool + span.start; }
+
+    void IRAM_ATTR release_before(const Span& span) {
+        if (span.gen == gen) {
+            tail = span.start;
+        }
+    }
+
+    void reset() {
+        nPending = 0;
+        head = tail = 0;
+        ++gen;
+    }
+}
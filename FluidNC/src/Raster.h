@@ -0,0 +1,68 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Raster.h - per-step laser power for raster engraving
+
+  A raster line is sent as one or more $Laser/Raster=<base64> commands
+  followed by an ordinary G1 move.  Each decoded byte is the power of one
+  pixel, 0 for off to 255 for the move's S value.  The planner attaches
+  the pending pixels to the next feed move, and the stepper ISR spreads
+  them evenly over the move's step events, changing the laser power at
+  each pixel boundary instead of once per segment.  One move therefore
+  carries a whole scan line instead of one G1 per pixel.
+
+  Pixels are kept in a ring pool from the time their move is planned
+  until the stepper ISR starts a later raster move.  The pool is filled
+  and drained in the same order as the planner blocks, so it only fills
+  up when the planner holds more pixels than it does.
+*/
+
+#include "Error.h"
+
+#include <cstdint>
+
+namespace Raster {
+    // Pixels attached to a planner block
+    struct Span {
+        uint16_t start;  // Offset of the first pixel in the pool
+        uint16_t count;  // 0 if the block has no raster
+        uint8_t  gen;    // Pool generation, so a reset pool ignores stale spans
+    };
+
+    const uint32_t poolSize   = 8192;
+    const uint32_t maxPending = 2048;  // Most pixels in one move
+
+    // Decodes base64 pixel data and appends it to the pending line
+    Error append(const char* base64);
+
+    // Drops the pending line
+    void clear();
+
+    // True if there is a pending line that the pool cannot take yet
+    bool waiting();
+
+    // Moves the pending line into the pool and describes it in span.
+    // stepEvents is the move's step count; a line with more pixels
+    // than steps cannot be rendered.  Returns false if the line was
+    // dropped, in which case the move must run with the laser off
+    // rather than at the full S value.
+    bool attach(Span& span, uint32_t stepEvents);
+
+    // Drops the pending line for a move that cannot carry one, like an
+    // arc or a line that the kinematics split, returning true if there
+    // was one.  As with attach(), the move
+    // must then run with the laser off.
+    bool reject();
+
+    // Returns the pool storage for a span
+    const uint8_t* pixels(const Span& span);
+
+    // Frees everything before a span, as the stepper ISR starts its move
+    void release_before(const Span& span);
+
+    // Empties the pool and the pending line, as after an abort
+    void reset();
+}
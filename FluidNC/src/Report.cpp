@@ -33,6 +33,7 @@
 #include "WebUI/WebSettings.h"
 #include "InputFile.h"
 #include "DownloadFile.h"
+#include "LineBuffer.h"
 
 #include <map>
 #include <freertos/task.h>
@@ -78,13 +79,13 @@ void _notifyf(const char* title, const char* format, ...) {
 Counter report_ovr_counter = 0;
 Counter report_wco_counter = 0;
 
-static const int coordStringLen = 20;
-static const int axesStringLen  = coordStringLen * MAX_N_AXIS;
+static const int coordStringLen  = 20;
+static const int axesStringLen   = coordStringLen * MAX_N_AXIS;
+static const int statusStringLen = 2 * axesStringLen + 200;
 
-// Sends the axis values to the output channel
-static std::string report_util_axis_values(const float* axis_value) {
-    std::ostringstream msg;
-    auto               n_axis = config->_axes->_numberAxis;
+// Writes the axis values to out without allocating
+static void report_util_axis_values(const float* axis_value, Print& out) {
+    auto n_axis = config->_axes->_numberAxis;
     for (size_t idx = 0; idx < n_axis; idx++) {
         int   decimals;
         float value = axis_value[idx];
@@ -102,12 +103,19 @@ static std::string report_util_axis_values(const float* axis_value) {
                 decimals = 3;  // Report mm to 3 decimal places
             }
         }
-        msg << std::fixed << std::setprecision(decimals) << value;
+        char buf[coordStringLen + 4];
+        out.write((const uint8_t*)buf, format_fixed(buf, value, decimals));
         if (idx < (n_axis - 1)) {
-            msg << ",";
+            out.write(',');
         }
     }
-    return msg.str();
+}
+
+// Sends the axis values to the output channel
+static std::string report_util_axis_values(const float* axis_value) {
+    LineBuffer<axesStringLen> msg;
+    report_util_axis_values(axis_value, msg);
+    return msg.c_str();
 }
 
 std::map<Message, const char*> MessageText = {
@@ -490,15 +498,14 @@ const char* state_name() {
     return "";
 }
 
-static std::string pinString() {
-    std::string msg;
-    bool        prefixNeeded = true;
+static void pinString(Print& out) {
+    bool prefixNeeded = true;
     if (config->_probe->get_state()) {
         if (prefixNeeded) {
             prefixNeeded = false;
-            msg += "|Pn:";
+            out.print("|Pn:");
         }
-        msg += 'P';
+        out.write('P');
     }
 
     MotorMask lim_pin_state = limits_get_state();
@@ -509,22 +516,22 @@ static std::string pinString() {
                 bitnum_is_true(lim_pin_state, Machine::Axes::motor_bit(axis, 1))) {
                 if (prefixNeeded) {
                     prefixNeeded = false;
-                    msg += "|Pn:";
+                    out.print("|Pn:");
                 }
-                msg += config->_axes->axisName(axis);
+                out.write(config->_axes->axisName(axis));
             }
         }
     }
 
-    std::string ctrl_pin_report = config->_control->report_status();
-    if (ctrl_pin_report.length()) {
-        if (prefixNeeded) {
-            prefixNeeded = false;
-            msg += "|Pn:";
+    for (auto pin : config->_control->_pins) {
+        if (pin->get()) {
+            if (prefixNeeded) {
+                prefixNeeded = false;
+                out.print("|Pn:");
+            }
+            out.write(pin->letter());
         }
-        msg += ctrl_pin_report;
     }
-    return msg;
 }
 
 // Define this to do something if a debug request comes in over serial
@@ -536,8 +543,10 @@ void report_realtime_debug() {}
 // requires as it minimizes the computational overhead to keep running smoothly,
 // especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
 void report_realtime_status(Channel& channel) {
-    LogStream msg(channel, "<");
-    msg << state_name();
+    // The report is assembled on the stack so that frequent auto-reports
+    // do not churn the heap.
+    LineBuffer<statusStringLen> msg;
+    msg << "<" << state_name();
 
     // Report position
     float* print_position = get_mpos();
@@ -547,7 +556,7 @@ void report_realtime_status(Channel& channel) {
         msg << "|WPos:";
         mpos_to_wpos(print_position);
     }
-    msg << report_util_axis_values(print_position).c_str();
+    report_util_axis_values(print_position, msg);
 
     // Returns planner and serial read buffer states.
 
@@ -571,9 +580,11 @@ void report_realtime_status(Channel& channel) {
     if (config->_reportInches) {
         rate /= MM_PER_INCH;
     }
-    msg << "|FS:" << setprecision(0) << rate << "," << sys.spindle_speed;
+    msg << "|FS:";
+    msg.fixed(rate, 0);
+    msg << "," << sys.spindle_speed;
 
-    msg << pinString();
+    pinString(msg);
 
     if (report_wco_counter > 0) {
         report_wco_counter--;
@@ -592,7 +603,8 @@ void report_realtime_status(Channel& channel) {
         if (report_ovr_counter == 0) {
             report_ovr_counter = 1;  // Set override on next report.
         }
-        msg << "|WCO:" << report_util_axis_values(get_wco()).c_str();
+        msg << "|WCO:";
+        report_util_axis_values(get_wco(), msg);
     }
 
     if (report_ovr_counter > 0) {
@@ -637,11 +649,13 @@ void report_realtime_status(Channel& channel) {
             }
         }
     }
-    if (InputFile::_progress.length()) {
-        msg << "|" + InputFile::_progress;
+    if (Stepper::underruns) {
+        msg << "|Un:" << Stepper::underruns;
     }
+
+    InputFile::report_progress(msg);
     if (DownloadFile::_progress.length()) {
-        msg << "|" + DownloadFile::_progress;
+        msg << "|" << DownloadFile::_progress;
     }
 #ifdef DEBUG_STEPPER_ISR
     msg << "|ISRs:" << Stepper::isr_count;
@@ -650,8 +664,7 @@ void report_realtime_status(Channel& channel) {
     msg << "|Heap:" << esp.getHeapSize();
 #endif
     msg << ">";
-    // The DebugStream destructor sends the line
-    // when msg goes out of scope
+    send_line(channel, msg.c_str(), msg.length());
 }
 
 void hex_msg(uint8_t* buf, const char* prefix, int len) {
@@ -16,6 +16,7 @@
 #include "src/SettingsDefinitions.h"
 #include "FluidPath.h"
 #include "Protocol.h"
+#include "SDIndex.h"
 
 SDCard::SDCard() : _state(State::Idle) {}
 
@@ -128,4 +129,141 @@ void SDCard::validate() {
 }
 #endif
 
+const Pin& SDCard::cardDetectPin() const {
+#ifdef USE_SDMMC
+    return _cd;
+#else
+    return _cardDetect;
+#endif
+}
+
+bool SDCard::persistent() const {
+    return _persistent && (cardDetectPin().defined() || _idleUnmountMs);
+}
+
+std::error_code SDCard::mountCard() {
+    uint32_t        start = millis();
+    std::error_code ec    = sd_mount();
+    uint32_t        ms    = millis() - start;
+    if (ec) {
+        ++_stats.failures;
+        return ec;
+    }
+    _mounted = true;
+    _lastUse = millis();
+    ++_stats.mounts;
+    _stats.mountMs += ms;
+    if (ms > _stats.maxMountMs) {
+        _stats.maxMountMs = ms;
+    }
+    return ec;
+}
+
+void SDCard::unmountCard() {
+    sd_unmount();
+    _mounted = false;
+    ++_stats.unmounts;
+}
+
+// Only the OLED files menu uses the index, so it is built when that menu
+// is entered instead of when the card is mounted.  Without card detect the
+// card could have been swapped since the last walk, so it is rebuilt each
+// time; file operations keep it current while the menu is open.
+void SDCard::indexFiles() {
+    if (!config->_oled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (sdIndex.valid() && cardDetectPin().defined()) {
+        return;
+    }
+    bool wasMounted = _mounted;
+    if (!_mounted && mountCard()) {
+        sdIndex.clear();  // No card
+        return;
+    }
+    sdIndex.rebuild();
+    if (!wasMounted && !_inUse && !persistent()) {
+        unmountCard();
+    }
+}
+
+void SDCard::updateMenu() {
+    uint32_t generation = sdIndex.generation();
+    if (config->_oled && generation != _menuGeneration) {
+        _menuGeneration = generation;
+        config->_oled->refresh_display(true);
+    }
+}
+
+std::error_code SDCard::mount() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::error_code             ec;
+    if (_mounted) {
+        ++_stats.reuses;
+    } else {
+        ec = mountCard();
+    }
+    if (!ec) {
+        _inUse = true;
+    }
+    return ec;
+}
+
+void SDCard::release() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _inUse   = false;
+    _lastUse = millis();
+
+    // The operation might have changed the files
+    updateMenu();
+
+    if (_mounted && !persistent()) {
+        unmountCard();
+    }
+}
+
+void SDCard::cardDetect(bool present) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (present) {
+        if (!_mounted) {
+            mountCard();
+        }
+        if (_mounted && config->_oled) {
+            sdIndex.rebuild();  // A new card; the files menu may be showing
+        }
+    } else {
+        if (_mounted) {
+            unmountCard();
+        }
+        sdIndex.clear();
+    }
+
+    // Update the files menu based on SD listing
+    updateMenu();
+
+    if (_mounted && !_inUse && !persistent()) {
+        unmountCard();
+    }
+}
+
+void SDCard::poll() {
+    if (!_idleUnmountMs || !_mounted || _inUse || (millis() - _lastUse) < _idleUnmountMs) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_mounted && !_inUse) {
+        unmountCard();
+        ++_stats.idleUnmounts;
+    }
+}
+
+void SDCard::report_stats(Channel& out) {
+    log_to(out,
+           "[SD:",
+           "mounted=" << _mounted << " persistent=" << persistent() << " files=" << sdIndex.size() << " scans=" << sdIndex._scans
+                      << " mounts=" << _stats.mounts << " reuses=" << _stats.reuses << " failures=" << _stats.failures << " unmounts=" << _stats.unmounts << " idleUnmounts=" << _stats.idleUnmounts
+                      << " mountTime=" << _stats.mountMs << "ms maxMount=" << _stats.maxMountMs << "ms");
+}
+
 SDCard::~SDCard() {}
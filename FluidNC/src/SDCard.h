@@ -10,6 +10,10 @@
 #include "Error.h"
 
 #include <cstdint>
+#include <mutex>
+#include <system_error>
+
+class Channel;
 
 class SDCard : public Configuration::Configurable {
 public:
@@ -35,6 +39,34 @@ private:
 
     uint32_t _frequency_hz = 4000000;  // Set to nonzero to override the default
 
+    // A persistent mount stays up between file operations instead of being
+    // redone for each one.  It needs a card detect pin or an idle timeout
+    // so that a swapped card is noticed.
+    bool     _persistent    = true;
+    uint32_t _idleUnmountMs = 0;  // Unmount after this long without file activity; 0 means never
+
+    std::mutex _mutex;  // Mounts can come from the polling, main and web tasks
+    bool       _mounted = false;
+    bool       _inUse   = false;  // Some FluidPath refers to /sd
+    uint32_t   _lastUse = 0;      // millis() when the card was last mounted or released
+
+    uint32_t _menuGeneration = 0;  // Of the SD index when the OLED menu was last refreshed
+
+    struct Stats {
+        uint32_t mounts       = 0;
+        uint32_t reuses       = 0;  // Mount requests that found the card already mounted
+        uint32_t failures     = 0;
+        uint32_t unmounts     = 0;
+        uint32_t idleUnmounts = 0;
+        uint32_t mountMs      = 0;  // Total time spent mounting
+        uint32_t maxMountMs   = 0;
+    } _stats;
+
+    const Pin&      cardDetectPin() const;
+    bool            persistent() const;
+    std::error_code mountCard();
+    void            unmountCard();
+
 public:
     SDCard();
     SDCard(const SDCard&) = delete;
@@ -45,6 +77,17 @@ public:
     // Initializes pins.
     void init();
 
+    // Mount lifecycle.  FluidPath calls mount() when the first path on /sd
+    // comes into use and release() when the last one goes away.
+    std::error_code mount();
+    void            release();
+    void            cardDetect(bool present);
+    void            poll();        // Performs the idle unmount
+    void            updateMenu();  // Refreshes the OLED files menu if the SD files have changed
+    void            indexFiles();  // Builds the SD index for the OLED files menu if it is needed
+
+    void report_stats(Channel& out);
+
 #ifdef USE_SDMMC
     // Configuration handlers.
     void group(Configuration::HandlerBase& handler) override {
@@ -60,6 +103,8 @@ public:
         handler.item("cd_pin", _cd);
 
         handler.item("frequency_hz", _frequency_hz, 400000, 50000000);
+        handler.item("persistent_mount", _persistent);
+        handler.item("idle_unmount_ms", _idleUnmountMs, 0, 3600000);
     }
 
     void validate() override;
@@ -69,6 +114,8 @@ public:
         handler.item("cs_pin", _cs);
         handler.item("card_detect_pin", _cardDetect);
         handler.item("frequency_hz", _frequency_hz, 400000, 20000000);
+        handler.item("persistent_mount", _persistent);
+        handler.item("idle_unmount_ms", _idleUnmountMs, 0, 3600000);
     }
 #endif
 
@@ -0,0 +1,156 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "SDIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+SDIndex sdIndex { "/sd" };
+
+bool SDIndex::listed(const std::filesystem::path& path) {
+    static const char* extensions[] = { ".gcode", ".nc", ".txt" };
+
+    std::string ext = path.extension().string();
+    for (auto& c : ext) {
+        c = tolower(c);
+    }
+    for (auto e : extensions) {
+        if (ext == e) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SDIndex::relative(const std::filesystem::path& path, std::string& rel) {
+    std::string s = path.generic_string();
+    if (s.compare(0, _root.size(), _root) != 0 || (s.size() > _root.size() && s[_root.size()] != '/')) {
+        return false;
+    }
+    rel = s.substr(_root.size());
+    while (rel.size() > 1 && rel.back() == '/') {
+        rel.pop_back();
+    }
+    if (rel == "/") {
+        rel.clear();
+    }
+    return true;
+}
+
+bool SDIndex::insert(const std::string& rel) {
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), rel);
+    if (it != _entries.end() && *it == rel) {
+        return false;
+    }
+    _entries.insert(it, rel);
+    return true;
+}
+
+// Erases rel and everything below it.  The entries that start with rel
+// are contiguous, but some of them, like /ab for /a, are not below it.
+bool SDIndex::erase(const std::string& rel) {
+    auto first = std::lower_bound(_entries.begin(), _entries.end(), rel);
+    auto last  = first;
+    while (last != _entries.end() && last->compare(0, rel.size(), rel) == 0) {
+        ++last;
+    }
+    auto end = std::remove_if(first, last, [&rel](const std::string& e) { return e.size() == rel.size() || e[rel.size()] == '/'; });
+    if (end == last) {
+        return false;
+    }
+    _entries.erase(end, last);
+    return true;
+}
+
+void SDIndex::scan(const std::filesystem::path& dir) {
+    ++_scans;
+    std::error_code ec;
+    std::string     rel;
+    for (auto it = std::filesystem::recursive_directory_iterator { dir, ec }; !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+        if (!it->is_directory(ec) && listed(it->path()) && relative(it->path(), rel)) {
+            insert(rel);
+        }
+    }
+}
+
+void SDIndex::rebuild() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+    scan(_root);
+    _valid = true;
+    ++_generation;
+}
+
+void SDIndex::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_valid || !_entries.empty()) {
+        _entries.clear();
+        _valid = false;
+        ++_generation;
+    }
+}
+
+void SDIndex::added(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string                 rel;
+    if (!_valid || !relative(path, rel)) {
+        return;
+    }
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec)) {
+        size_t before = _entries.size();
+        scan(path);
+        if (_entries.size() != before) {
+            ++_generation;
+        }
+    } else if (listed(path) && insert(rel)) {
+        ++_generation;
+    }
+}
+
+void SDIndex::removed(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string                 rel;
+    if (!_valid || !relative(path, rel)) {
+        return;
+    }
+    if (rel.empty()) {
+        if (!_entries.empty()) {
+            _entries.clear();
+            ++_generation;
+        }
+    } else if (erase(rel)) {
+        ++_generation;
+    }
+}
+
+void SDIndex::renamed(const std::filesystem::path& from, const std::filesystem::path& to) {
+    removed(from);
+    added(to);
+}
+
+bool SDIndex::valid() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _valid;
+}
+
+size_t SDIndex::size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+bool SDIndex::get(size_t i, std::string& path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (i >= _entries.size()) {
+        return false;
+    }
+    path = _entries[i];
+    return true;
+}
+
+uint32_t SDIndex::generation() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _generation;
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  SDIndex.h - in-memory index of the job files on the SD card
+
+  The OLED files menu used to be rebuilt by walking the whole card each
+  time an SD path was released.  The index is built by one walk when the
+  files menu is entered.  After that, the operations that change the card
+  keep it current: file writes, deletes and renames.  The menu is paged out of
+  the index without touching the card.
+
+  Entries are paths relative to the card root, with a leading '/', kept
+  sorted.  The generation count changes whenever the entries do, so a
+  reader can tell that its copy is stale.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SDIndex {
+public:
+    explicit SDIndex(const char* root) : _root(root) {}
+
+    void rebuild();  // Walks the whole card
+    void clear();
+
+    // Paths are absolute, like FluidPaths.  Paths outside the root are ignored.
+    void added(const std::filesystem::path& path);    // A file was written, or a directory was copied in
+    void removed(const std::filesystem::path& path);  // A file, or a directory and everything below it
+    void renamed(const std::filesystem::path& from, const std::filesystem::path& to);
+
+    bool     valid();
+    size_t   size();
+    bool     get(size_t i, std::string& path);  // Copies out entry i; false past the end
+    uint32_t generation();
+
+    uint32_t _scans = 0;  // Walks of the card or of a directory
+
+    static bool listed(const std::filesystem::path& path);  // Has a job file extension
+
+private:
+    bool relative(const std::filesystem::path& path, std::string& rel);
+    void scan(const std::filesystem::path& dir);
+    bool insert(const std::string& rel);
+    bool erase(const std::string& rel);
+
+    std::string              _root;
+    std::mutex               _mutex;
+    std::vector<std::string> _entries;
+    bool                     _valid      = false;
+    uint32_t                 _generation = 0;
+};
+
+extern SDIndex sdIndex;
@@ -98,7 +98,7 @@ public:
         }
 
         buffer[-1] = 0x40;  // control
-        _i2c->write(_address, (char*)&buffer[-1], displayBufferSize + 1);
+        _i2c->write(_address, &buffer[-1], displayBufferSize + 1);
 #endif
     }
 
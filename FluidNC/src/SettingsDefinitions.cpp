@@ -11,6 +11,8 @@ IntSetting* status_mask;
 
 IntSetting* sd_fallback_cs;
 
+EnumSetting* sd_prefetch;
+
 EnumSetting* message_level;
 
 enum_opt_t messageLevels = {
@@ -60,6 +62,8 @@ void make_settings() {
 
     sd_fallback_cs = new IntSetting("SD CS pin if not configured", EXTENDED, WG, NULL, "SD/FallbackCS", -1, -1, 40, NULL);
 
+    sd_prefetch = new EnumSetting("Read file jobs ahead in a background task", EXTENDED, WG, NULL, "SD/Prefetch", 0, &onoffOptions, NULL);
+
     build_info = new StringSetting("OEM build info for $I command", EXTENDED, WG, NULL, "Firmware/Build", "", 0, 20, NULL);
 
     start_message =
@@ -12,4 +12,6 @@ extern IntSetting* status_mask;
 
 extern IntSetting* sd_fallback_cs;
 
+extern EnumSetting* sd_prefetch;
+
 extern EnumSetting* message_level;
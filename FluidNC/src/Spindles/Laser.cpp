@@ -31,6 +31,7 @@ namespace Spindles {
         // A speed map is now present and PWM::init() will not set its own default
 
         PWM::init();
+        setupRateTable();
 
         // Turn off is_reversable regardless of what PWM::init() thinks.
         // Laser mode uses M4 for speed-dependent power instead of CCW rotation.
@@ -24,6 +24,7 @@ namespace Spindles {
         Laser& operator=(Laser&&) = delete;
 
         bool isRateAdjusted() override;
+        bool isrRateAdjusted() override { return _isrPowerScaling; }
         void config_message() override;
         void init() override;
         void set_direction(bool Clockwise) override {};
@@ -36,9 +37,16 @@ namespace Spindles {
             // We cannot call PWM::group() because that would pick up
             // direction_pin, which we do not want in Laser
             handler.item("pwm_hz", _pwm_freq, 1000, 100000);
+            handler.item("isr_power_scaling", _isrPowerScaling);
             OnOff::groupCommon(handler);
         }
 
         ~Laser() {}
+
+    private:
+        // In M4 mode, have the stepper ISR scale the power by each segment's actual step rate,
+        // through a table built from the speed map, instead of prep_buffer() calling mapSpeed()
+        // for the speed at the end of each segment
+        bool _isrPowerScaling = false;
     };
 }
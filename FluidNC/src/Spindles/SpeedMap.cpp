@@ -0,0 +1,61 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "SpeedMap.h"
+
+uint32_t IRAM_ATTR SpeedMap::scan(const Segment* segments, size_t n, uint32_t speed) {
+    if (speed < segments[0].speed || speed == 0) {
+        return segments[0].offset;
+    }
+    size_t num_segments = n - 1;
+    size_t i;
+    for (i = 0; i < num_segments; i++) {
+        if (speed < segments[i + 1].speed) {
+            break;
+        }
+    }
+    uint32_t dev_speed = segments[i].offset;
+
+    // If the requested speed is greater than the maximum map speed,
+    // i will be equal to num_segments, in which case we just return
+    // the maximum dev_speed.  Otherwise, we interpolate by applying
+    // the segment scale factor to the segment offset.
+    if (i < num_segments) {
+        dev_speed += uint32_t(((speed - segments[i].speed) * uint64_t(segments[i].scale)) >> 16);
+    }
+    return dev_speed;
+}
+
+void SpeedMap::index() {
+    _indexed = false;
+    size_t n = _segments.size();
+
+    // Bucket entries are uint8_t, and the bucket walk in lookup() relies on
+    // ascending speeds.  Anything else falls back to scan(), as do small
+    // maps, which it searches faster than lookup() indexes them.
+    if (n <= maxScanned || n > 255) {
+        return;
+    }
+    for (size_t i = 1; i < n; i++) {
+        if (_segments[i].speed < _segments[i - 1].speed) {
+            return;
+        }
+    }
+
+    _top   = _segments[n - 1].speed;
+    _shift = 0;
+    while ((_top >> _shift) >= uint32_t(nBuckets)) {
+        ++_shift;
+    }
+
+    // Each bucket holds the segment that its lowest speed falls in, as scan() would choose it
+    size_t i = 0;
+    for (int b = 0; b < nBuckets; b++) {
+        uint32_t start = uint32_t(b) << _shift;
+        while (i < n - 1 && start >= _segments[i + 1].speed) {
+            ++i;
+        }
+        _bucket[b] = uint8_t(i);
+    }
+    _indexed = true;
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  SpeedMap.h - constant-time lookup in a spindle speed map
+
+  A speed map is a list of breakpoints, each with a speed, the device
+  value at that speed and the 16.16 slope to the next breakpoint, as
+  computed by Spindle::setupSpeeds().  Finding the segment for a speed
+  used to be a linear scan on every call.  build() divides the range
+  from 0 to the top speed into buckets and records the segment at the
+  start of each one, so lookup() indexes the bucket with a shift and
+  only steps past breakpoints that fall inside that bucket - none for
+  typical maps of 5 to 10 entries.
+
+  The results are the same as those of scan(), which is the original
+  interpolation.  It is kept as a reference for tests, for maps whose
+  speeds are not in ascending order, and for maps of up to maxScanned
+  entries, like the two-entry linearSpeeds default, where the scan is
+  faster than the index.
+
+  Spindle::interpolateSpeed() calls lookup() from the stepper ISR, so
+  lookup() and scan() are placed in IRAM.
+*/
+
+#ifdef ESP32
+#    include <esp_attr.h>  // IRAM_ATTR
+#else
+#    define IRAM_ATTR
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SpeedMap {
+public:
+    struct Segment {
+        uint32_t speed;
+        uint32_t offset;
+        uint32_t scale;
+    };
+
+    static const int    nBuckets   = 256;
+    static const size_t maxScanned = 4;  // Smaller maps are not indexed
+
+    // Entry is any type with speed, offset and scale members, such as Configuration::speedEntry
+    template <typename Entry>
+    void build(const std::vector<Entry>& entries) {
+        _segments.clear();
+        for (auto& e : entries) {
+            _segments.push_back({ uint32_t(e.speed), e.offset, e.scale });
+        }
+        index();
+    }
+
+    void clear() {
+        _segments.clear();
+        _indexed = false;
+    }
+
+    bool empty() const { return _segments.empty(); }
+
+    inline uint32_t IRAM_ATTR lookup(uint32_t speed) const {
+        if (!_indexed) {
+            return _segments.empty() ? 0 : scan(_segments.data(), _segments.size(), speed);
+        }
+        const Segment* s = _segments.data();
+        if (speed == 0 || speed < s[0].speed) {
+            return s[0].offset;
+        }
+        if (speed >= _top) {
+            return s[_segments.size() - 1].offset;
+        }
+        uint32_t i = _bucket[speed >> _shift];
+        while (speed >= s[i + 1].speed) {
+            ++i;
+        }
+        return s[i].offset + uint32_t(((speed - s[i].speed) * uint64_t(s[i].scale)) >> 16);
+    }
+
+    // The linear search that lookup() replaces
+    static uint32_t scan(const Segment* segments, size_t n, uint32_t speed);
+
+private:
+    void index();
+
+    std::vector<Segment> _segments;
+    bool                 _indexed = false;
+    uint32_t             _top     = 0;  // Speed of the last breakpoint
+    int                  _shift   = 0;  // Speed to bucket number
+    uint8_t              _bucket[nBuckets];
+};
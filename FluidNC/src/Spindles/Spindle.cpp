@@ -48,6 +48,7 @@ namespace Spindles {
     void Spindle::setupSpeeds(uint32_t max_dev_speed) {
         int nsegments = _speeds.size() - 1;
         if (nsegments < 1) {
+            _speedMap.build(_speeds);
             return;
         }
         int i;
@@ -77,6 +78,8 @@ namespace Spindles {
         _speeds[i].offset = offset;
         scaler            = 0;
         _speeds[i].scale  = scaler;
+
+        _speedMap.build(_speeds);
     }
 
     void Spindle::afterParse() {
@@ -109,35 +112,48 @@ namespace Spindles {
         }
         speed             = speed * sys.spindle_speed_ovr / 100;
         sys.spindle_speed = speed;
-        if (speed < _speeds[0].speed) {
-            return _speeds[0].offset;
-        }
-        if (speed == 0) {
-            return _speeds[0].offset;
+        return interpolateSpeed(speed);
+    }
+
+    uint32_t IRAM_ATTR Spindle::interpolateSpeed(SpindleSpeed speed) {
+        return _speedMap.lookup(speed);
+    }
+
+    void Spindle::setupRateTable() {
+        _rateTable.clear();
+        if (_speeds.size() == 0) {
+            return;
         }
-        int num_segments = _speeds.size() - 1;
-        int i;
-        for (i = 0; i < num_segments; i++) {
-            if (speed < _speeds[i + 1].speed) {
-                break;
-            }
+        uint64_t top = maxSpeed();
+        for (int i = 0; i <= rateTableSteps; i++) {
+            _rateTable.push_back(interpolateSpeed(SpindleSpeed(top * i / rateTableSteps)));
         }
-        uint32_t dev_speed = _speeds[i].offset;
-
-        // If the requested speed is greater than the maximum map speed,
-        // i will be equal to num_segements, in which case we just return
-        // the maximum dev_speed.
+    }
 
-        // Otherwise, we interpolate by applying the segment scale factor
-        // to the segment offset .
-        if (i < num_segments) {
-            dev_speed += uint32_t((((speed - _speeds[i].speed) * uint64_t(_speeds[i].scale)) >> 16));
+    uint32_t Spindle::speedFraction(SpindleSpeed speed) {
+        if (_speeds.size() == 0) {
+            return 0;
         }
+        uint64_t fraction = (uint64_t(speed) * sys.spindle_speed_ovr << 16) / (uint64_t(maxSpeed()) * 100);
+        return fraction > 0x10000 ? 0x10000 : uint32_t(fraction);
+    }
 
-        // log_debug("rpm " << speed << " speed " << dev_speed); // This will spew quite a bit of data on your output
-        return dev_speed;
+    // Linear interpolation in _rateTable; called from the stepper ISR
+    uint32_t IRAM_ATTR Spindle::mapSpeedFraction(uint32_t fraction) {
+        if (_rateTable.empty()) {
+            return 0;
+        }
+        if (fraction >= 0x10000) {
+            return _rateTable[rateTableSteps];
+        }
+        uint32_t scaled = fraction * rateTableSteps;  // Table index in 16.16 fixed point
+        uint32_t i      = scaled >> 16;
+        int64_t  delta  = int64_t(_rateTable[i + 1]) - int64_t(_rateTable[i]);
+        return _rateTable[i] + int32_t((delta * (scaled & 0xffff)) >> 16);
     }
-    void Spindle::spindleDelay(SpindleState state, SpindleSpeed speed) {
+
+    // The spinup and spindown time for a change from the current state and speed
+    uint32_t Spindle::spindleDelayMs(SpindleState state, SpindleSpeed speed) {
         uint32_t up = 0, down = 0;
         switch (state) {
             case SpindleState::Unknown:
@@ -197,11 +213,20 @@ namespace Spindles {
                         break;
                 }
         }
+        uint32_t ms = 0;
         if (down) {
-            delay(down < maxSpeed() ? _spindown_ms * down / maxSpeed() : _spindown_ms);
+            ms += down < maxSpeed() ? _spindown_ms * down / maxSpeed() : _spindown_ms;
         }
         if (up) {
-            delay(up < maxSpeed() ? _spinup_ms * up / maxSpeed() : _spinup_ms);
+            ms += up < maxSpeed() ? _spinup_ms * up / maxSpeed() : _spinup_ms;
+        }
+        return ms;
+    }
+
+    void Spindle::spindleDelay(SpindleState state, SpindleSpeed speed) {
+        uint32_t ms = spindleDelayMs(state, speed);
+        if (ms) {
+            delay(ms);
         }
         _current_state = state;
         _current_speed = speed;
@@ -6,6 +6,7 @@
 #include <cstdint>
 
 #include "../SpindleDatatypes.h"
+#include "SpeedMap.h"
 
 #include "../Configuration/Configurable.h"
 #include "../Configuration/GenericFactory.h"
@@ -37,9 +38,16 @@ namespace Spindles {
         void     shelfSpeeds(SpindleSpeed min, SpindleSpeed max);
         void     linearSpeeds(SpindleSpeed maxSpeed, float maxPercent);
 
+        // Laser power scaling in the stepper ISR.  Fractions are of maxSpeed(), in 16.16 fixed point.
+        static const int rateTableSteps = 64;
+        void             setupRateTable();
+        uint32_t         speedFraction(SpindleSpeed speed);  // Applies the spindle override
+        uint32_t         mapSpeedFraction(uint32_t fraction);
+
         static void switchSpindle(uint32_t new_tool, SpindleList spindles, Spindle*& spindle);
 
         void         spindleDelay(SpindleState state, SpindleSpeed speed);
+        uint32_t     spindleDelayMs(SpindleState state, SpindleSpeed speed);
         virtual void init() = 0;  // not in constructor because this also gets called when $$ settings change
 
         // Used by Protocol.cpp to restore the state during a restart
@@ -48,6 +56,7 @@ namespace Spindles {
         void         stop() { setState(SpindleState::Disable, 0); }
         virtual void config_message() = 0;
         virtual bool isRateAdjusted();
+        virtual bool isrRateAdjusted() { return false; }  // M4 power is scaled by the ISR rather than per segment
         virtual bool use_delay_settings() const { return true; }
 
         virtual void setSpeedfromISR(uint32_t dev_speed) = 0;
@@ -91,6 +100,15 @@ namespace Spindles {
 
         // Virtual base classes require a virtual destructor.
         virtual ~Spindle() {}
+
+    private:
+        uint32_t interpolateSpeed(SpindleSpeed speed);
+
+        // Bucket index over _speeds, rebuilt by setupSpeeds()
+        SpeedMap _speedMap;
+
+        // Device speeds at maxSpeed() * i / rateTableSteps, for mapSpeedFraction()
+        std::vector<uint32_t> _rateTable;
     };
     using SpindleFactory = Configuration::GenericFactory<Spindle>;
 }
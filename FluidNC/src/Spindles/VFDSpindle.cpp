@@ -27,228 +27,289 @@
 
 #include <freertos/task.h>
 #include <freertos/queue.h>
+#include <esp32-hal.h>  // millis()
+#include <algorithm>
 #include <atomic>
 
-const int        VFD_RS485_BUF_SIZE   = 127;
-const int        VFD_RS485_QUEUE_SIZE = 10;                                     // number of commands that can be queued up.
-const int        RESPONSE_WAIT_MS     = 1000;                                   // how long to wait for a response
-const int        VFD_RS485_POLL_RATE  = 250;                                    // in milliseconds between commands
-const TickType_t response_ticks       = RESPONSE_WAIT_MS / portTICK_PERIOD_MS;  // in milliseconds between commands
+const int      VFD_RS485_QUEUE_SIZE     = 10;     // number of commands that can be queued up.
+const uint32_t RESPONSE_WAIT_MS         = 1000;   // how long to wait for a response
+const uint32_t VFD_RS485_POLL_RATE      = 250;    // in milliseconds between status polls
+const uint32_t VFD_RS485_SYNC_POLL_RATE = 50;     // in milliseconds between speed polls while waiting for speed
+const int      VFD_RS485_MAX_RETRIES    = 5;      // otherwise the spindle is marked 'unresponsive'
+const uint32_t VFD_SYNC_CHECK_MS        = 10;     // how often the wait checks the reported speed
+const uint32_t VFD_SYNC_STALL_MS        = 10000;  // how long the reported speed can stay unchanged
 
 namespace Spindles {
-    QueueHandle_t VFD::vfd_cmd_queue     = nullptr;
-    TaskHandle_t  VFD::vfd_cmdTaskHandle = nullptr;
+    // The Modbus master and the task that runs it for one RS485 UART.
+    // Mode and speed changes reach the task through the inbox, from
+    // the protocol loop and from the stepper ISR; everything else
+    // happens on the task, so the master needs no locking.
+    struct VFD::Bus : public Modbus::Port {
+        static const int maxSpindles = 4;
+
+        Uart&            uart;
+        Modbus::Master   master;
+        QueueHandle_t    inbox;
+        VFD*             spindles[maxSpindles];
+        std::atomic<int> nSpindles;
+
+        static std::vector<Bus*> all;
+
+        Bus(Uart& u) : uart(u), master(*this, u._baud), nSpindles(0) {
+            master._timeoutMs  = RESPONSE_WAIT_MS;
+            master._maxRetries = VFD_RS485_MAX_RETRIES;
+        }
 
-    void VFD::reportParsingErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length) {
-#ifdef DEBUG_VFD
-        hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
-        hex_msg(rx_message, "RS485 Rx: ", read_length);
-#endif
-    }
-    void VFD::reportCmdErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length, uint8_t id) {
-#ifdef DEBUG_VFD
-        hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
-        hex_msg(rx_message, "RS485 Rx: ", read_length);
-
-        if (read_length != 0) {
-            if (rx_message[0] != id) {
-                log_info("RS485 received message from other modbus device");
-            } else if (read_length != cmd.rx_length) {
-                log_info("RS485 received message of unexpected length; expected:" << int(cmd.rx_length) << " got:" << int(read_length));
-            } else {
-                log_info("RS485 CRC check failed");
+        void send(const uint8_t* data, size_t length) override { uart.write(data, length); }
+
+        size_t receive(uint8_t* data, size_t length) override {
+            int avail = uart.available();
+            if (avail <= 0) {
+                return 0;
             }
-        } else {
-            log_info("RS485 No response");
+            return uart.timedReadBytes(data, std::min(length, size_t(avail)), 0);
         }
-#endif
-    }
 
-    // The communications task
-    void VFD::vfd_cmd_task(void* pvParameters) {
-        static bool unresponsive = false;  // to pop off a message once each time it becomes unresponsive
-        static int  pollidx      = -1;
+        void discard() override { uart.flushRx(); }
 
-        VFD*          instance = static_cast<VFD*>(pvParameters);
-        auto&         uart     = *instance->_uart;
-        ModbusCommand next_cmd;
-        uint8_t       rx_message[VFD_RS485_MAX_MSG_SIZE];
-        bool          safetyPollingEnabled = instance->safety_polling();
-
-        for (; true; delay_ms(VFD_RS485_POLL_RATE)) {
-            std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);  // read fence for settings
-            response_parser parser = nullptr;
+        void add(VFD* spindle) {
+            int n = nSpindles;
+            for (int i = 0; i < n; i++) {
+                if (spindles[i] == spindle) {
+                    return;
+                }
+            }
+            if (n == maxSpindles) {
+                log_error("Too many VFDs on " << uart.name());
+                return;
+            }
+            spindles[n] = spindle;
+            nSpindles   = n + 1;
+        }
 
-            // First check if we should ask the VFD for the speed parameters as part of the initialization.
-            if (pollidx < 0 && (parser = instance->initialization_sequence(pollidx, next_cmd)) != nullptr) {
-            } else {
-                pollidx = 1;  // Done with initialization. Main sequence.
+        static Bus* get(Uart* uart) {
+            for (auto bus : all) {
+                if (&bus->uart == uart) {
+                    return bus;
+                }
             }
-            next_cmd.critical = false;
+            auto bus   = new Bus(*uart);
+            bus->inbox = xQueueCreate(VFD_RS485_QUEUE_SIZE, sizeof(VFDaction));
+            all.push_back(bus);
+            xTaskCreatePinnedToCore(task,                 // task
+                                    "vfd_cmdTaskHandle",  // name for task
+                                    2048,                 // size of task stack
+                                    bus,                  // parameters
+                                    1,                    // priority
+                                    nullptr,
+                                    SUPPORT_TASK_CORE  // core
+            );
+            return bus;
+        }
 
-            VFDaction action;
-            if (parser == nullptr) {
-                // If we don't have a parser, the queue goes first.
-                if (xQueueReceive(vfd_cmd_queue, &action, 0)) {
-                    switch (action.action) {
-                        case actionSetSpeed:
-                            if (!instance->prepareSetSpeedCommand(action.arg, next_cmd)) {
-                                // prepareSetSpeedCommand() can return false if the speed
-                                // change is unnecessary - already at that speed.
-                                // In that case we just discard the command.
-                                continue;  // main loop
-                            }
-                            next_cmd.critical = action.critical;
-                            break;
-                        case actionSetMode:
-                            log_debug("vfd_cmd_task mode:" << action.action);
-                            if (!instance->prepareSetModeCommand(SpindleState(action.arg), next_cmd)) {
-                                continue;  // main loop
-                            }
-                            next_cmd.critical = action.critical;
-                            break;
-                    }
-                } else {
-                    // We do not have a parser and there is nothing in the queue, so we cycle
-                    // through the set of periodic queries.
-
-                    // We poll in a cycle. Note that the switch will fall through unless we encounter a hit.
-                    // The weakest form here is 'get_status_ok' which should be implemented if the rest fails.
-                    if (instance->_syncing) {
-                        parser = instance->get_current_speed(next_cmd);
-                    } else if (safetyPollingEnabled) {
-                        switch (pollidx) {
-                            case 1:
-                                parser = instance->get_current_speed(next_cmd);
-                                if (parser) {
-                                    pollidx = 2;
-                                    break;
-                                }
-                                // fall through if get_current_speed did not return a parser
-                            case 2:
-                                parser = instance->get_current_direction(next_cmd);
-                                if (parser) {
-                                    pollidx = 3;
-                                    break;
-                                }
-                                // fall through if get_current_direction did not return a parser
-                            case 3:
-                            default:
-                                parser  = instance->get_status_ok(next_cmd);
-                                pollidx = 1;
-
-                                // we could complete this in case parser == nullptr with some ifs, but let's
-                                // just keep it easy and wait an iteration.
-                                break;
-                        }
-                    }
+        // The communications task.  It sleeps until an action arrives or
+        // the master or a spindle has something to do, whichever is first.
+        static void task(void* pvParameters) {
+            auto     bus  = static_cast<Bus*>(pvParameters);
+            uint32_t wait = 0;
+            while (true) {
+                VFDaction action;
+                if (xQueueReceive(bus->inbox, &action, std::max(TickType_t(1), TickType_t(pdMS_TO_TICKS(wait))))) {
+                    do {
+                        action.spindle->accept(action);
+                    } while (xQueueReceive(bus->inbox, &action, 0));
+                }
+                std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);  // read fence for settings
 
-                    // If we have no parser, that means get_status_ok is not implemented (and we have
-                    // nothing resting in our queue). Let's fall back on a simple continue.
-                    if (parser == nullptr) {
-                        continue;  // main loop
-                    }
+                uint32_t now = millis();
+                wait         = VFD_RS485_POLL_RATE;
+                int n        = bus->nSpindles;
+                for (int i = 0; i < n; i++) {
+                    wait = std::min(wait, bus->spindles[i]->schedule(now));
                 }
+                wait = std::min(wait, bus->master.service(now));
             }
+        }
+    };
+
+    std::vector<VFD::Bus*> VFD::Bus::all;
+
+    // Called by the bus task when the actions in the inbox are drained.
+    // Only the latest mode and speed matter, so newer ones replace older
+    // ones that have not been sent yet.
+    void VFD::accept(const VFDaction& action) {
+        switch (action.action) {
+            case actionSetSpeed:
+                _pendingSpeed  = action.arg;
+                _speedCritical = action.critical;
+                _speedPending  = true;
+                break;
+            case actionSetMode:
+                _pendingMode  = SpindleState(action.arg);
+                _modeCritical = action.critical;
+                _modePending  = true;
+                if (_pendingMode == SpindleState::Disable) {
+                    _speedPending = false;  // Turning the spindle off drops speed changes queued before it
+                }
+                break;
+        }
+    }
 
-            // At this point next_cmd has been filled with a command block
-            {
-                // Fill in the fields that are the same for all protocol variants
-                next_cmd.msg[0] = instance->_modbus_id;
+    // The periodic status queries, in turn
+    VFD::response_parser VFD::poll(ModbusCommand& data) {
+        if (_syncing) {
+            return get_current_speed(data);
+        }
+        if (!safety_polling()) {
+            return nullptr;
+        }
+        response_parser parser = nullptr;
+
+        // We poll in a cycle. Note that the switch will fall through unless we encounter a hit.
+        // The weakest form here is 'get_status_ok' which should be implemented if the rest fails.
+        switch (_pollidx) {
+            case 1:
+                parser = get_current_speed(data);
+                if (parser) {
+                    _pollidx = 2;
+                    break;
+                }
+                // fall through if get_current_speed did not return a parser
+            case 2:
+                parser = get_current_direction(data);
+                if (parser) {
+                    _pollidx = 3;
+                    break;
+                }
+                // fall through if get_current_direction did not return a parser
+            case 3:
+            default:
+                parser   = get_status_ok(data);
+                _pollidx = 1;
+                break;
+        }
+        return parser;
+    }
 
-                // Grabbed the command. Add the CRC16 checksum:
-                auto crc16                         = ModRTU_CRC(next_cmd.msg, next_cmd.tx_length);
-                next_cmd.msg[next_cmd.tx_length++] = (crc16 & 0xFF);
-                next_cmd.msg[next_cmd.tx_length++] = (crc16 & 0xFF00) >> 8;
-                next_cmd.rx_length += 2;
+    // Gives the master this spindle's next request, if it has none in
+    // progress.  Initialization goes first, then mode and speed changes,
+    // then status polls.  Returns the number of milliseconds until it
+    // might have something to send.
+    uint32_t VFD::schedule(uint32_t now_ms) {
+        if (_busy) {
+            return VFD_RS485_POLL_RATE;
+        }
 
-#ifdef DEBUG_VFD_ALL
-                if (parser == nullptr) {
-                    hex_msg(next_cmd.msg, "RS485 Tx: ", next_cmd.tx_length);
-                }
-#endif
+        ModbusCommand   cmd;
+        response_parser parser   = nullptr;
+        auto            priority = Modbus::Priority::Command;
+        cmd.critical             = false;
+
+        // First check if we should ask the VFD for the speed parameters as part of the initialization.
+        if (_pollidx < 0) {
+            parser = initialization_sequence(_pollidx, cmd);
+            if (!parser) {
+                _pollidx = 1;  // Done with initialization. Main sequence.
             }
+        }
 
-            // Assume for the worst, and retry...
-            int retry_count = 0;
-            for (; retry_count < MAX_RETRIES; ++retry_count) {
-                // Flush the UART and write the data:
-                uart.flush();
-                uart.write(next_cmd.msg, next_cmd.tx_length);
-                uart.flushTxTimed(response_ticks);
-
-                // Read the response
-                size_t read_length  = 0;
-                size_t current_read = uart.timedReadBytes(rx_message, next_cmd.rx_length, response_ticks);
-                read_length += current_read;
-
-                // Apparently some Huanyang report modbus errors in the correct way, and the rest not. Sigh.
-                // Let's just check for the condition, and truncate the first byte.
-                if (read_length > 0 && instance->_modbus_id != 0 && rx_message[0] == 0) {
-                    memmove(rx_message + 1, rx_message, read_length - 1);
-                }
+        if (!parser) {
+            bool command = false;
+            if (_modePending) {
+                _modePending = false;
+                command      = prepareSetModeCommand(_pendingMode, cmd);
+                cmd.critical = _modeCritical;
+            } else if (_speedPending) {
+                // prepareSetSpeedCommand() can return false if the speed
+                // change is unnecessary - already at that speed.
+                _speedPending = false;
+                command       = prepareSetSpeedCommand(_pendingSpeed, cmd);
+                cmd.critical  = _speedCritical;
+            }
 
-                while (read_length < next_cmd.rx_length && current_read > 0) {
-                    // Try to read more; we're not there yet...
-                    current_read = uart.timedReadBytes(rx_message + read_length, next_cmd.rx_length - read_length, response_ticks);
-                    read_length += current_read;
+            if (command) {
+                priority = Modbus::Priority::Setpoint;
+            } else {
+                uint32_t rate = _syncing ? VFD_RS485_SYNC_POLL_RATE : VFD_RS485_POLL_RATE;
+                if (now_ms - _lastPoll < rate) {
+                    return rate - (now_ms - _lastPoll);
                 }
+                _lastPoll = now_ms;
+                priority  = Modbus::Priority::Poll;
 
-                // Generate crc16 for the response:
-                auto crc16response = ModRTU_CRC(rx_message, next_cmd.rx_length - 2);
-
-                if (read_length == next_cmd.rx_length &&                             // check expected length
-                    rx_message[0] == instance->_modbus_id &&                         // check address
-                    rx_message[read_length - 1] == (crc16response & 0xFF00) >> 8 &&  // check CRC byte 1
-                    rx_message[read_length - 2] == (crc16response & 0xFF)) {         // check CRC byte 1
-
-                    // Success
-                    unresponsive = false;
-                    retry_count  = MAX_RETRIES + 1;  // stop retry'ing
-
-                    // Should we parse this?
-                    if (parser != nullptr) {
-                        if (parser(rx_message, instance)) {
-                            // If we're initializing, move to the next initialization command:
-                            if (pollidx < 0) {
-                                --pollidx;
-                            }
-                        } else {
-                            // Parsing failed
-                            reportParsingErrors(next_cmd, rx_message, read_length);
-
-                            // If we were initializing, move back to where we started.
-                            unresponsive = true;
-                            pollidx      = -1;  // Re-initializing the VFD seems like a plan
-                            log_info("Spindle RS485 did not give a satisfying response");
-                        }
-                    }
-                } else {
-                    reportCmdErrors(next_cmd, rx_message, read_length, instance->_modbus_id);
+                // If we have no parser, that means get_status_ok is not implemented
+                parser = poll(cmd);
+                if (!parser) {
+                    return VFD_RS485_POLL_RATE;
+                }
+            }
+        }
 
-                    // Wait a bit before we retry. Set the delay to poll-rate. Not sure
-                    // if we should use a different value...
-                    delay_ms(VFD_RS485_POLL_RATE);
+        // Fill in the fields that are the same for all protocol variants
+        cmd.msg[0] = _modbus_id;
 
-#ifdef DEBUG_TASK_STACK
-                    static UBaseType_t uxHighWaterMark = 0;
-                    reportTaskStackSize(uxHighWaterMark);
+#ifdef DEBUG_VFD_ALL
+        if (parser == nullptr) {
+            hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
+        }
 #endif
-                }
-            }
 
-            if (retry_count == MAX_RETRIES) {
-                if (!unresponsive) {
-                    log_info("VFD RS485 Unresponsive");
-                    unresponsive = true;
-                    pollidx      = -1;
-                }
-                if (next_cmd.critical) {
-                    log_error("Critical VFD RS485 Unresponsive");
-                    mc_reset();
-                    rtAlarm = ExecAlarm::SpindleControl;
+        Modbus::Request request;
+        request.priority = priority;
+        request.txLength = cmd.tx_length;
+        request.rxLength = cmd.rx_length;
+        request.done     = completion;
+        request.context  = this;
+        memcpy(request.msg, cmd.msg, cmd.tx_length);
+        if (!_bus->master.submit(request)) {
+            log_info("VFD Queue Full");
+            return VFD_RS485_POLL_RATE;
+        }
+        _busy     = true;
+        _parser   = parser;
+        _critical = cmd.critical;
+        return 0;
+    }
+
+    void VFD::completion(const Modbus::Request& request, Modbus::Result result, const uint8_t* response) {
+        static_cast<VFD*>(request.context)->complete(result, response);
+    }
+
+    void VFD::complete(Modbus::Result result, const uint8_t* response) {
+        _busy = false;
+
+        if (result == Modbus::Result::Ok) {
+            _unresponsive = false;
+
+            // Should we parse this?
+            if (_parser != nullptr) {
+                if (_parser(response, this)) {
+                    // If we're initializing, move to the next initialization command:
+                    if (_pollidx < 0) {
+                        --_pollidx;
+                    }
+                } else {
+                    // If we were initializing, move back to where we started.
+                    _unresponsive = true;
+                    _pollidx      = -1;  // Re-initializing the VFD seems like a plan
+                    log_info("Spindle RS485 did not give a satisfying response");
                 }
             }
+            return;
+        }
+
+#ifdef DEBUG_VFD
+        log_info("RS485 " << (result == Modbus::Result::Exception ? "exception response" : "no response"));
+#endif
+        if (!_unresponsive) {
+            log_info("VFD RS485 Unresponsive");
+            _unresponsive = true;
+            _pollidx      = -1;
+        }
+        if (_critical) {
+            log_error("Critical VFD RS485 Unresponsive");
+            mc_reset();
+            rtAlarm = ExecAlarm::SpindleControl;
         }
     }
 
@@ -282,17 +343,11 @@ namespace Spindles {
 
         _current_state = SpindleState::Disable;
 
-        // Initialization is complete, so now it's okay to run the queue task:
-        if (!vfd_cmd_queue) {  // init can happen many times, we only want to start one task
-            vfd_cmd_queue = xQueueCreate(VFD_RS485_QUEUE_SIZE, sizeof(VFDaction));
-            xTaskCreatePinnedToCore(vfd_cmd_task,         // task
-                                    "vfd_cmdTaskHandle",  // name for task
-                                    2048,                 // size of task stack
-                                    this,                 // parameters
-                                    1,                    // priority
-                                    &vfd_cmdTaskHandle,
-                                    SUPPORT_TASK_CORE  // core
-            );
+        // Initialization is complete, so now it's okay to run the bus task.
+        // init can happen many times, but there is only one task per UART.
+        if (!_bus) {
+            _bus = Bus::get(_uart);
+            _bus->add(this);
         }
 
         config_message();
@@ -313,6 +368,19 @@ namespace Spindles {
         uint32_t dev_speed = mapSpeed(speed);
         log_debug("RPM:" << speed << " mapped to device units:" << dev_speed);
 
+        // With speed_sync, the configured delays are the most we wait
+        uint32_t fallback_ms = use_delay_settings() ? spindleDelayMs(state, speed) : 0;
+
+        // A direction change has to slow through zero, even at the same speed
+        bool reversing = _current_state != state && _current_state != SpindleState::Disable && state != SpindleState::Disable;
+
+        // A reading from before the new setpoint says nothing about it.  The
+        // bus task also clears this when it sends the speed, but that can be
+        // after the wait starts, and a mode change alone does not send one.
+        if (_current_state != state || _current_dev_speed != dev_speed) {
+            _sync_dev_speed = UINT32_MAX;
+        }
+
         if (_current_state != state) {
             // Changing state
             set_mode(state, critical);  // critical if we are in a job
@@ -325,81 +393,115 @@ namespace Spindles {
                 setSpeed(dev_speed);
             }
         }
-        if (use_delay_settings()) {
+        if (use_delay_settings() && !_speedSync) {
             spindleDelay(state, speed);
         } else {
-            // _sync_dev_speed is set by a callback that handles
-            // responses from periodic get_current_speed() requests.
-            // It changes as the actual speed ramps toward the target.
-
-            _syncing = true;  // poll for speed
+            waitForSpeed(dev_speed, fallback_ms, reversing);
 
-            auto minSpeedAllowed = dev_speed > _slop ? (dev_speed - _slop) : 0;
-            auto maxSpeedAllowed = dev_speed + _slop;
-
-            int       unchanged = 0;
-            const int limit     = 20;  // 20 * 0.5s = 10 sec
-            auto      last      = _sync_dev_speed;
+            // spindleDelay() sets these when it is used
+            _current_state = state;
+            _current_speed = speed;
+        }
+        //        }
+    }
 
-            while ((_last_override_value == sys.spindle_speed_ovr) &&  // skip if the override changes
-                   ((_sync_dev_speed < minSpeedAllowed || _sync_dev_speed > maxSpeedAllowed) && unchanged < limit)) {
+    // Waits until the speed that the VFD reports is within the tolerance
+    // band around dev_speed.  _sync_dev_speed is set by a callback that
+    // handles responses from periodic get_current_speed() requests.  It
+    // changes as the actual speed ramps toward the target.  Most VFDs report
+    // an unsigned frequency, so when reversing, the speed has to be seen
+    // below the band before it counts as reaching it in the new direction.
+    void VFD::waitForSpeed(uint32_t dev_speed, uint32_t fallback_ms, bool reversing) {
+        _syncing = true;  // poll for speed
+
+        uint32_t band            = _speedTolerance ? dev_speed * _speedTolerance / 100 : _slop;
+        auto     minSpeedAllowed = dev_speed > band ? (dev_speed - band) : 0;
+        auto     maxSpeedAllowed = dev_speed + band;
+        uint32_t timeout_ms      = _speedTimeoutMs ? _speedTimeoutMs : fallback_ms;
+
+        uint32_t start       = millis();
+        uint32_t last_change = start;
+        auto     last        = _sync_dev_speed;
+        bool     at_speed    = false;
+        bool     stalled     = false;
+        bool     slowed      = !reversing || minSpeedAllowed == 0;
+
+        while (!sys.abort && _last_override_value == sys.spindle_speed_ovr) {  // skip if the override changes
+            if (_sync_dev_speed < minSpeedAllowed) {
+                slowed = true;
+            }
+            if (slowed && _sync_dev_speed >= minSpeedAllowed && _sync_dev_speed <= maxSpeedAllowed) {
+                at_speed = true;
+                break;
+            }
 #ifdef DEBUG_VFD
-                log_debug("Syncing speed. Requested: " << int(dev_speed) << " current:" << int(_sync_dev_speed));
+            log_debug("Syncing speed. Requested: " << int(dev_speed) << " current:" << int(_sync_dev_speed));
 #endif
-                // if (!mc_dwell(500)) {
-                //     // Something happened while we were dwelling, like a safety door.
-                //     unchanged = limit;
-                //     last      = _sync_dev_speed;
-                //     break;
-                // }
-                delay_ms(500);
-
-                // unchanged counts the number of consecutive times that we see the same speed
-                unchanged = (_sync_dev_speed == last) ? unchanged + 1 : 0;
-                last      = _sync_dev_speed;
+            uint32_t now = millis();
+            if (_sync_dev_speed != last) {
+                last        = _sync_dev_speed;
+                last_change = now;
+            }
+            if (now - last_change >= VFD_SYNC_STALL_MS) {
+                stalled = true;
+                break;
+            }
+            if (timeout_ms && now - start >= timeout_ms) {
+                break;
             }
-            _last_override_value = sys.spindle_speed_ovr;
+            delay_ms(VFD_SYNC_CHECK_MS);
+        }
+        uint32_t waited      = millis() - start;
+        _last_override_value = sys.spindle_speed_ovr;
+        _syncing             = false;
 
 #ifdef DEBUG_VFD
-            log_debug("Synced speed. Requested:" << int(dev_speed) << " current:" << int(_sync_dev_speed));
+        log_debug("Synced speed. Requested:" << int(dev_speed) << " current:" << int(_sync_dev_speed));
 #endif
 
-            if (unchanged == limit) {
-                log_error(name() << " spindle did not reach device units " << dev_speed << ". Reported value is " << _sync_dev_speed);
-                mc_reset();
-                rtAlarm = ExecAlarm::SpindleControl;
+        if (at_speed) {
+            ++_syncCount;
+            _syncTotalMs += waited;
+            if (fallback_ms > waited) {
+                _syncSavedMs += fallback_ms - waited;
             }
-
-            _syncing = false;
-            // spindleDelay() sets these when it is used
-            _current_state = state;
-            _current_speed = speed;
+            if (use_delay_settings()) {
+                log_info(name() << " spindle at speed in " << waited << "ms instead of " << fallback_ms << "ms; " << _syncSavedMs
+                                << "ms saved in " << _syncCount << " changes");
+            } else {
+                log_info(name() << " spindle at speed in " << waited << "ms; " << _syncTotalMs << "ms in " << _syncCount << " changes");
+            }
+            return;
+        }
+        if (stalled && !use_delay_settings()) {
+            log_error(name() << " spindle did not reach device units " << dev_speed << ". Reported value is " << _sync_dev_speed);
+            mc_reset();
+            rtAlarm = ExecAlarm::SpindleControl;
+            return;
+        }
+        if (!sys.abort && _last_override_value == sys.spindle_speed_ovr) {
+            log_warn(name() << " spindle did not report device units " << dev_speed << " within " << waited << "ms. Reported value is "
+                            << _sync_dev_speed);
         }
-        //        }
     }
 
     bool VFD::prepareSetModeCommand(SpindleState mode, ModbusCommand& data) {
         // Do variant-specific command preparation
         direction_command(mode, data);
 
-        if (mode == SpindleState::Disable) {
-            if (!xQueueReset(vfd_cmd_queue)) {
-                log_info(name() << " spindle off, queue could not be reset");
-            }
-        }
-
         _current_state = mode;
         return true;
     }
 
     void VFD::set_mode(SpindleState mode, bool critical) {
         _last_override_value = sys.spindle_speed_ovr;  // sync these on mode changes
-        if (vfd_cmd_queue) {
+        if (_bus) {
             VFDaction action;
+            action.spindle  = this;
             action.action   = actionSetMode;
             action.arg      = uint32_t(mode);
             action.critical = critical;
-            if (xQueueSend(vfd_cmd_queue, &action, 0) != pdTRUE) {
+            if (xQueueSend(_bus->inbox, &action, 0) != pdTRUE) {
                 log_info("VFD Queue Full");
             }
         }
@@ -412,24 +514,26 @@ namespace Spindles {
 
         _last_speed = dev_speed;
 
-        if (vfd_cmd_queue) {
+        if (_bus) {
             VFDaction action;
+            action.spindle  = this;
             action.action   = actionSetSpeed;
             action.arg      = dev_speed;
             action.critical = (dev_speed == 0);
-            if (xQueueSendFromISR(vfd_cmd_queue, &action, 0) != pdTRUE) {
+            if (xQueueSendFromISR(_bus->inbox, &action, 0) != pdTRUE) {
                 log_info("VFD Queue Full");
             }
         }
     }
 
     void VFD::setSpeed(uint32_t dev_speed) {
-        if (vfd_cmd_queue) {
+        if (_bus) {
             VFDaction action;
+            action.spindle  = this;
             action.action   = actionSetSpeed;
             action.arg      = dev_speed;
             action.critical = dev_speed == 0;
-            if (xQueueSend(vfd_cmd_queue, &action, 0) != pdTRUE) {
+            if (xQueueSend(_bus->inbox, &action, 0) != pdTRUE) {
                 log_info("VFD Queue Full");
             }
         }
@@ -454,26 +558,4 @@ namespace Spindles {
 
         return true;
     }
-
-    // Calculate the CRC on all of the byte except the last 2
-    // It then added the CRC to those last 2 bytes
-    // full_msg_len This is the length of the message including the 2 crc bytes
-    // Source: https://ctlsys.com/support/how_to_compute_the_modbus_rtu_message_crc/
-    uint16_t VFD::ModRTU_CRC(uint8_t* buf, int msg_len) {
-        uint16_t crc = 0xFFFF;
-        for (int pos = 0; pos < msg_len; pos++) {
-            crc ^= uint16_t(buf[pos]);  // XOR byte into least sig. byte of crc.
-
-            for (int i = 8; i != 0; i--) {  // Loop over each bit
-                if ((crc & 0x0001) != 0) {  // If the LSB is set
-                    crc >>= 1;              // Shift right and XOR 0xA001
-                    crc ^= 0xA001;
-                } else {        // Else LSB is not set
-                    crc >>= 1;  // Just shift right
-                }
-            }
-        }
-
-        return crc;
-    }
 }
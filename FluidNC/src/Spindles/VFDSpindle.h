@@ -8,6 +8,7 @@
 #include "../Types.h"
 
 #include "../Uart.h"
+#include "../Modbus.h"
 
 // #define DEBUG_VFD
 // #define DEBUG_VFD_ALL
@@ -18,7 +19,6 @@ namespace Spindles {
     class VFD : public Spindle {
     private:
         static const int VFD_RS485_MAX_MSG_SIZE = 16;  // more than enough for a modbus message
-        static const int MAX_RETRIES            = 5;   // otherwise the spindle is marked 'unresponsive'
 
         void set_mode(SpindleState mode, bool critical);
 
@@ -26,13 +26,13 @@ namespace Spindles {
         uint32_t _last_speed          = 0;
         Percent  _last_override_value = 100;  // no override is 100 percent
 
-        static QueueHandle_t vfd_cmd_queue;
-        static TaskHandle_t  vfd_cmdTaskHandle;
-        static void          vfd_cmd_task(void* pvParameters);
+        // The RS485 bus task and Modbus master, shared by the VFDs on one UART
+        struct Bus;
+        Bus* _bus = nullptr;
 
-        static uint16_t ModRTU_CRC(uint8_t* buf, int msg_len);
         enum VFDactionType : uint8_t { actionSetSpeed, actionSetMode };
         struct VFDaction {
+            VFD*          spindle;
             VFDactionType action;
             bool          critical;
             uint32_t      arg;
@@ -51,9 +51,6 @@ namespace Spindles {
         bool prepareSetModeCommand(SpindleState mode, ModbusCommand& data);
         bool prepareSetSpeedCommand(uint32_t speed, ModbusCommand& data);
 
-        static void reportParsingErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length);
-        static void reportCmdErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length, uint8_t id);
-
     protected:
         // Commands:
         virtual void direction_command(SpindleState mode, ModbusCommand& data) = 0;
@@ -78,6 +75,30 @@ namespace Spindles {
 
         volatile bool _syncing;
 
+    private:
+        // Run by the bus task
+        void            accept(const VFDaction& action);
+        uint32_t        schedule(uint32_t now_ms);
+        response_parser poll(ModbusCommand& data);
+        void            complete(Modbus::Result result, const uint8_t* response);
+        void            waitForSpeed(uint32_t dev_speed, uint32_t fallback_ms, bool reversing);
+        static void     completion(const Modbus::Request& request, Modbus::Result result, const uint8_t* response);
+
+        // Bus task state.  The latest mode and speed requests wait here
+        // until the spindle's previous transaction is done.
+        int             _pollidx       = -1;  // Negative while initializing
+        bool            _unresponsive  = false;
+        bool            _busy          = false;  // A request is with the master
+        response_parser _parser        = nullptr;
+        bool            _critical      = false;
+        uint32_t        _lastPoll      = 0;
+        bool            _modePending   = false;
+        SpindleState    _pendingMode   = SpindleState::Disable;
+        bool            _modeCritical  = false;
+        bool            _speedPending  = false;
+        uint32_t        _pendingSpeed  = 0;
+        bool            _speedCritical = false;
+
     public:
         VFD() {}
         VFD(const VFD&) = delete;
@@ -93,6 +114,18 @@ namespace Spindles {
         volatile uint32_t _sync_dev_speed;
         SpindleSpeed      _slop;
 
+        // Closed-loop spindle-at-speed.  VFDs that otherwise use spinup_ms and
+        // spindown_ms wait for the reported speed instead when _speedSync is set,
+        // with those delays as the timeout unless _speedTimeoutMs is given.
+        bool     _speedSync      = false;
+        uint32_t _speedTolerance = 0;  // Percent of the target speed; 0 uses the VFD's own _slop
+        uint32_t _speedTimeoutMs = 0;
+
+        // Time spent waiting for speed, and saved against the delays
+        uint32_t _syncCount   = 0;
+        uint32_t _syncTotalMs = 0;
+        uint32_t _syncSavedMs = 0;
+
         // Configuration handlers:
         void validate() override {
             Spindle::validate();
@@ -104,6 +137,11 @@ namespace Spindles {
             handler.section("uart", _uart, 1);
             handler.item("uart_num", _uart_num);
             handler.item("modbus_id", _modbus_id, 0, 247);  // per https://modbus.org/docs/PI_MBUS_300.pdf
+            if (use_delay_settings()) {
+                handler.item("speed_sync", _speedSync);
+            }
+            handler.item("speed_tolerance_percent", _speedTolerance, 0, 50);
+            handler.item("speed_timeout_ms", _speedTimeoutMs, 0, 60000);
 
             Spindle::group(handler);
         }
@@ -0,0 +1,185 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "StepTrace.h"
+
+#include "Machine/MachineConfig.h"  // config->_stepping
+#include "FileStream.h"
+#include "Logging.h"
+#include "Driver/delay_usecs.h"  // getCpuTicks(), ticks_per_us
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+namespace StepTrace {
+    std::atomic<bool> enabled { false };
+
+    struct Record {
+        int32_t  cycles;  // CPU cycle counter
+        uint16_t period;  // Segment ISR period, for Segment records
+        Event    event;
+    };
+
+    static const uint32_t ringSize = 2048;
+    static const int      nBuckets = 16;
+
+    static Record*  ring = nullptr;
+    static uint32_t ringHead;  // Next record to write
+    static uint32_t ringCount;
+
+    // Jitter is binned by powers of two of 2^unitShift CPU cycles
+    static int      unitShift;
+    static uint32_t buckets[nBuckets];
+    static uint32_t nTicks;
+    static uint32_t nSegments;
+    static uint32_t nStops;
+    static uint32_t nUnderruns;
+    static int32_t  maxLate;   // Cycles
+    static int32_t  maxEarly;  // Cycles
+
+    static int32_t lastCycles;
+    static bool    haveLast;  // False for the first tick after the timer starts
+    static int32_t expected;  // Timer period in effect, in CPU cycles
+
+    static void IRAM_ATTR record(Event event, int32_t cycles, uint16_t period) {
+        Record& r = ring[ringHead];
+        r.cycles  = cycles;
+        r.period  = period;
+        r.event   = event;
+        ringHead  = ringHead == ringSize - 1 ? 0 : ringHead + 1;
+        if (ringCount < ringSize) {
+            ++ringCount;
+        }
+    }
+
+    void IRAM_ATTR on_pulse() {
+        int32_t now = getCpuTicks();
+        record(Event::Pulse, now, 0);
+        if (haveLast && expected) {
+            int32_t  jitter = (now - lastCycles) - expected;
+            uint32_t units  = uint32_t(jitter < 0 ? -jitter : jitter) >> unitShift;
+            int      bucket = units ? 32 - __builtin_clz(units) : 0;
+            ++buckets[bucket < nBuckets ? bucket : nBuckets - 1];
+            maxLate  = std::max(maxLate, jitter);
+            maxEarly = std::min(maxEarly, jitter);
+            ++nTicks;
+        }
+        lastCycles = now;
+        haveLast   = true;
+    }
+
+    void IRAM_ATTR on_segment(uint16_t period) {
+        record(Event::Segment, getCpuTicks(), period);
+        // The new period applies from this tick to the next one
+        expected = int32_t(period) * int32_t(ticks_per_us) / int32_t(Machine::Stepping::fStepperTimer / 1000000);
+        ++nSegments;
+    }
+
+    void IRAM_ATTR on_stop(bool underrun) {
+        record(underrun ? Event::Underrun : Event::Stop, getCpuTicks(), 0);
+        ++(underrun ? nUnderruns : nStops);
+        haveLast = false;
+        expected = 0;
+    }
+
+    void reset() {
+        bool was = enabled;
+        enabled  = false;
+        memset(buckets, 0, sizeof(buckets));
+        nTicks = nSegments = nStops = nUnderruns = 0;
+        maxLate = maxEarly = 0;
+        ringHead = ringCount = 0;
+        haveLast             = false;
+        expected             = 0;
+        enabled              = was;
+    }
+
+    void start() {
+        if (!ring) {
+            // Not in PSRAM, which the ISR must not touch
+            ring = static_cast<Record*>(heap_caps_malloc(ringSize * sizeof(Record), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+            if (!ring) {
+                log_error("No internal RAM for the step trace");
+                return;
+            }
+        }
+        unitShift = 0;
+        while ((2u << unitShift) <= ticks_per_us / 8) {  // About 1/8 microsecond
+            ++unitShift;
+        }
+        reset();
+        enabled = true;
+    }
+
+    void stop() {
+        enabled = false;
+    }
+
+    static int cycles_to_ns(int64_t cycles) { return int(cycles * 1000 / int32_t(ticks_per_us)); }
+
+    void report(Channel& out) {
+        log_to(out,
+               "[STEPTRACE:",
+               (enabled ? "on" : "off") << " engine=" << stepTypes[Machine::Stepping::_engine].name << " ticks=" << nTicks
+                                        << " segments=" << nSegments << " stops=" << nStops << " underruns=" << nUnderruns
+                                        << " late=" << cycles_to_ns(maxLate) << "ns early=" << cycles_to_ns(-maxEarly) << "ns");
+        if (Machine::Stepping::_engine == Machine::Stepping::I2S_STREAM) {
+            log_to(out, "[STEPTRACE:", "I2S_stream runs the ISR ahead of the DMA, so tick jitter does not reflect pin timing");
+        }
+        LogStream s(out, "[STEPTRACE:");
+        s << "jitter";
+        for (int i = 0; i < nBuckets; i++) {
+            if (buckets[i]) {
+                s << " <" << cycles_to_ns(int64_t(1) << (unitShift + i)) << "ns:" << buckets[i];
+            }
+        }
+    }
+
+    static const char* event_name(Event event) {
+        switch (event) {
+            case Event::Pulse:
+                return "pulse";
+            case Event::Segment:
+                return "segment";
+            case Event::Stop:
+                return "stop";
+            case Event::Underrun:
+                return "underrun";
+        }
+        return "?";
+    }
+
+    Error save(const char* path, Channel& out) {
+        if (!ring) {
+            log_error_to(out, "Step trace is not running");
+            return Error::InvalidStatement;
+        }
+        FileStream* file;
+        try {
+            // Use a file on the local file system unless there is an explicit prefix like /sd/
+            file = new FileStream(path, "w", "");
+        } catch (Error err) { return err; }
+
+        // Stop recording so the ring does not move while it is written
+        bool was = enabled;
+        enabled  = false;
+
+        *file << "# cpu_ticks_per_us=" << int(ticks_per_us) << " timer_ticks_per_us=" << int(Machine::Stepping::fStepperTimer / 1000000)
+              << "\n";
+        *file << "event,cycles,period\n";
+        uint32_t index = (ringHead + ringSize - ringCount) % ringSize;
+        for (uint32_t i = 0; i < ringCount; i++) {
+            const Record& r = ring[index];
+            *file << event_name(r.event) << ',' << unsigned(r.cycles) << ',' << int(r.period) << '\n';
+            index = index == ringSize - 1 ? 0 : index + 1;
+        }
+        uint32_t count = ringCount;
+        delete file;
+
+        enabled = was;
+        log_info_to(out, "Wrote " << count << " step trace records to " << path);
+        return Error::Ok;
+    }
+}
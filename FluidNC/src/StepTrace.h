@@ -0,0 +1,52 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  StepTrace.h - timing trace of the stepper ISR
+
+  When enabled, the stepper ISR stamps its entry, each segment load and
+  each stop with the CPU cycle counter.  The stamps go into a fixed ring
+  in RAM, and the interval between ticks is compared with the timer
+  period the ISR asked for, giving a histogram of tick jitter and the
+  worst late and early ticks.  Stops are classified as underruns when
+  the segment buffer ran dry while the planner still had motion queued.
+  Tracing costs one flag test per tick while it is off.
+*/
+
+#include "Error.h"
+
+#include <atomic>
+#include <cstdint>
+
+class Channel;
+
+namespace StepTrace {
+    enum class Event : uint8_t {
+        Pulse,     // ISR entry
+        Segment,   // New segment loaded; period is its ISR period in stepper timer ticks
+        Stop,      // Segment buffer empty at the end of motion or in a hold
+        Underrun,  // Segment buffer empty while the planner had motion queued
+    };
+
+    extern std::atomic<bool> enabled;  // Set by commands, read by the ISR
+
+    // Called from the stepper ISR
+    void on_pulse();
+    void on_segment(uint16_t period);
+    void on_stop(bool underrun);
+
+    // Allocates the ring in internal RAM, which the ISR can always reach,
+    // and starts tracing
+    void start();
+    // Stops tracing, keeping the ring so it can be saved
+    void stop();
+    // Clears the histogram and the ring
+    void reset();
+
+    void report(Channel& out);
+
+    // Writes the ring, oldest first, as CSV text
+    Error save(const char* path, Channel& out);
+}
@@ -15,6 +15,8 @@
 #include "StepperPrivate.h"
 #include "Planner.h"
 #include "Protocol.h"
+#include "StepTrace.h"
+#include "Raster.h"
 #include <esp_attr.h>  // IRAM_ATTR
 #include <cmath>
 
@@ -33,6 +35,13 @@ struct st_block_t {
     uint32_t step_event_count;
     uint8_t  direction_bits;
     bool     is_pwm_rate_adjusted;  // Tracks motions that require constant laser power/rate
+    uint32_t rate_ref_ticks;        // Timer ticks per step event at the programmed rate, if the ISR scales laser power
+
+    const uint8_t* raster;        // Pixel powers, applied evenly over the step events
+    uint16_t       raster_start;  // Their Raster::Span, so the ISR can free the pixels before them
+    uint8_t        raster_gen;
+    uint16_t       raster_count;  // Number of pixels; 0 for no raster
+    uint32_t       raster_scale;  // Device speed for a 255 pixel, times 256/255
 };
 static volatile st_block_t* st_block_buffer = nullptr;
 
@@ -46,10 +55,13 @@ struct segment_t {
     uint8_t      st_block_index;     // Stepper block data index. Uses this information to execute this segment.
     uint8_t      amass_level;        // AMASS level for the ISR to execute this segment
     uint32_t     spindle_dev_speed;  // Spindle speed scaled to the device
+    uint32_t     spindle_fraction;   // Spindle speed as a 16.16 fraction of the top of the speed map, for ISR power scaling
     SpindleSpeed spindle_speed;      // Spindle speed in GCode units
 };
 static segment_t* segment_buffer = nullptr;
 
+static void select_pulse_kernel();
+
 void Stepper::init() {
     if (st_block_buffer) {
         delete[] st_block_buffer;
@@ -59,6 +71,8 @@ void Stepper::init() {
         delete[] segment_buffer;
     }
     segment_buffer = new segment_t[config->_stepping->_segments];
+
+    select_pulse_kernel();
 }
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
@@ -73,6 +87,10 @@ typedef struct {
     uint8_t  dir_outbits;
     uint32_t steps[MAX_N_AXIS];
 
+    uint32_t raster_counter;  // Bresenham counter for advancing through the raster pixels
+    uint32_t raster_inc;      // Its increment, adjusted for the AMASS level; 0 for no raster
+    uint16_t raster_index;    // Pixel being output
+
     uint16_t             step_count;        // Steps remaining in line segment motion
     uint8_t              exec_block_index;  // Tracks the current st_block index. Change indicates new block.
     volatile st_block_t* exec_block;        // Pointer to the block data for the segment being executed
@@ -88,6 +106,7 @@ static uint32_t          segment_next_head;
 // Pointers for the step segment being prepped from the planner buffer. Accessed only by the
 // main program. Pointers may be planning segments or planner blocks ahead of what being executed.
 static plan_block_t*        pl_block;       // Pointer to the planner block being prepped
+static plan_profile_t*      pl_profile;     // Acceleration profile of pl_block
 static volatile st_block_t* st_prep_block;  // Pointer to the stepper block data being prepped
 
 // Segment preparation data struct. Contains all the necessary information to compute new segments
@@ -185,6 +204,19 @@ void IRAM_ATTR Stepper::stop_stepping() {
 uint32_t Stepper::isr_count;  // for debugging only
 #endif
 
+uint32_t Stepper::underruns;
+
+// Values the stepper ISR needs on every tick, copied from the machine configuration
+// when the pulse kernel is selected so the ISR does not chase config pointers.  Like
+// all static data on the ESP32 this is in internal DRAM, so it can be read while the
+// flash cache is disabled.
+static struct {
+    Machine::Axes*     axes;
+    Machine::Stepping* stepping;
+    Probe*             probe;
+    uint32_t           last_segment;  // Index of the last entry in segment_buffer
+} isr;
+
 /**
  * This phase of the ISR should ONLY create the pulses for the steppers.
  * This prevents jitter caused by the interval between the start of the
@@ -192,18 +224,53 @@ uint32_t Stepper::isr_count;  // for debugging only
  * call to this method that might cause variation in the timing. The aim
  * is to keep pulse timing as regular as possible.
  * Returns true if step interrupts should continue
+ *
+ * The kernel is instantiated for each axis count so the per-axis loops
+ * have a constant trip count; select_pulse_kernel() picks the one for the
+ * configured machine.
  */
-bool IRAM_ATTR Stepper::pulse_func() {
+// True if the segment buffer ran dry while motion was still queued, as
+// opposed to running out at the end of motion or in a feed hold
+static bool IRAM_ATTR segment_underrun() {
+    return (sys.state == State::Cycle || sys.state == State::Jog) && !plan_buffer_empty();
+}
+
+// Laser power for a segment in proportion to its step rate, so the power per
+// distance is constant through acceleration and deceleration
+static uint32_t IRAM_ATTR rate_power(volatile st_block_t* block, volatile segment_t* segment) {
+    uint32_t fraction = segment->spindle_fraction;
+    uint32_t ref      = block->rate_ref_ticks;
+    uint32_t period   = uint32_t(segment->isrPeriod) << segment->amass_level;  // Timer ticks per step event
+    if (period > ref) {
+        // fraction <= 0x10000 and ref < period < 2^19, so scale down long periods to stay within 32 bits
+        if (ref >= 0x10000) {
+            ref >>= 3;
+            period >>= 3;
+        }
+        fraction = fraction * ref / period;
+    }
+    return spindle->mapSpeedFraction(fraction);
+}
+
+// Device speed for a raster pixel
+static inline uint32_t IRAM_ATTR raster_power(volatile st_block_t* block, uint16_t index) {
+    return (uint32_t(block->raster[index]) * block->raster_scale) >> 8;
+}
+
+template <int N_AXIS>
+static bool IRAM_ATTR pulse_kernel() {
 #ifdef DEBUG_STEPPER_ISR
     isr_count++;
 #endif
+    if (StepTrace::enabled) {
+        StepTrace::on_pulse();
+    }
     // This is a precaution in case we get a spurious interrupt
     if (!awake) {
         return false;
     }
-    auto n_axis = config->_axes->_numberAxis;
 
-    config->_axes->step(st.step_outbits, st.dir_outbits);
+    isr.axes->step(st.step_outbits, st.dir_outbits);
 
     // If there is no step segment, attempt to pop one from the stepper buffer
     if (st.exec_segment == NULL) {
@@ -212,32 +279,65 @@ bool IRAM_ATTR Stepper::pulse_func() {
             // Initialize new step segment and load number of steps to execute
             st.exec_segment = &segment_buffer[segment_buffer_tail];
             // Initialize step segment timing per step and load number of steps to execute.
-            config->_stepping->setTimerPeriod(st.exec_segment->isrPeriod);
+            isr.stepping->setTimerPeriod(st.exec_segment->isrPeriod);
+            if (StepTrace::enabled) {
+                StepTrace::on_segment(st.exec_segment->isrPeriod);
+            }
             st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
             // If the new segment starts a new planner block, initialize stepper variables and counters.
             // NOTE: When the segment data index changes, this indicates a new planner block.
             if (st.exec_block_index != st.exec_segment->st_block_index) {
                 st.exec_block_index = st.exec_segment->st_block_index;
                 st.exec_block       = &st_block_buffer[st.exec_block_index];
+                // Earlier raster moves are done with their pixels.  A parked partial block
+                // restarts its own span, so only the pixels before it are freed.
+                if (st.exec_block->raster_count) {
+                    Raster::release_before({ st.exec_block->raster_start, st.exec_block->raster_count, st.exec_block->raster_gen });
+                }
                 // Initialize Bresenham line and distance counters
-                for (int axis = 0; axis < n_axis; axis++) {
+                for (int axis = 0; axis < N_AXIS; axis++) {
                     st.counter[axis] = st.exec_block->step_event_count >> 1;
                 }
+                // Pixel boundaries fall exactly on multiples of the pixel pitch
+                st.raster_counter = 0;
+                st.raster_index   = 0;
             }
 
             st.dir_outbits = st.exec_block->direction_bits;
             // Adjust Bresenham axis increment counters according to AMASS level.
-            for (int axis = 0; axis < n_axis; axis++) {
-                st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
+            uint8_t amass_level = st.exec_segment->amass_level;
+            for (int axis = 0; axis < N_AXIS; axis++) {
+                st.steps[axis] = st.exec_block->steps[axis] >> amass_level;
             }
             // Set real-time spindle output as segment is loaded, just prior to the first step.
-            spindle->setSpeedfromISR(st.exec_segment->spindle_dev_speed);
+            // Raster moves set it from the pixels instead.
+            uint16_t raster_count = st.exec_block->raster_count;
+            if (raster_count) {
+                st.raster_inc = (uint32_t(raster_count) << maxAmassLevel) >> amass_level;
+                if (st.raster_index < raster_count) {
+                    spindle->setSpeedfromISR(raster_power(st.exec_block, st.raster_index));
+                }
+            } else {
+                st.raster_inc = 0;
+                if (st.exec_block->rate_ref_ticks) {
+                    spindle->setSpeedfromISR(rate_power(st.exec_block, st.exec_segment));
+                } else {
+                    spindle->setSpeedfromISR(st.exec_segment->spindle_dev_speed);
+                }
+            }
         } else {
             // Segment buffer empty. Shutdown.
             stop_stepping();
+            bool underrun = segment_underrun();
+            if (underrun) {
+                ++underruns;
+            }
+            if (StepTrace::enabled) {
+                StepTrace::on_stop(underrun);
+            }
             if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
                 // Ensure pwm is set properly upon completion of rate-controlled motion.
-                if (st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted) {
+                if (st.exec_block != NULL && (st.exec_block->is_pwm_rate_adjusted || st.exec_block->raster_count)) {
                     spindle->setSpeedfromISR(0);
                 }
             }
@@ -249,25 +349,35 @@ bool IRAM_ATTR Stepper::pulse_func() {
     }
 
     // Check probing state.
-    if (probeState == ProbeState::Active && config->_probe->tripped()) {
+    if (probeState == ProbeState::Active && isr.probe->tripped()) {
         probeState = ProbeState::Off;
-        auto axes  = config->_axes;
-        for (int axis = 0; axis < n_axis; axis++) {
-            auto m            = axes->_axis[axis]->_motors[0];
+        for (int axis = 0; axis < N_AXIS; axis++) {
+            auto m            = isr.axes->_axis[axis]->_motors[0];
             probe_steps[axis] = m ? m->_steps : 0;
         }
         protocol_send_event_from_ISR(&motionCancelEvent);
     }
 
-    // Reset step out bits.
-    st.step_outbits = 0;
-
-    for (int axis = 0; axis < n_axis; axis++) {
-        // Execute step displacement profile by Bresenham line algorithm
+    // Execute step displacement profile by Bresenham line algorithm
+    uint32_t step_event_count = st.exec_block->step_event_count;
+    uint8_t  step_outbits     = 0;
+    for (int axis = 0; axis < N_AXIS; axis++) {
         st.counter[axis] += st.steps[axis];
-        if (st.counter[axis] > st.exec_block->step_event_count) {
-            set_bitnum(st.step_outbits, axis);
-            st.counter[axis] -= st.exec_block->step_event_count;
+        if (st.counter[axis] > step_event_count) {
+            set_bitnum(step_outbits, axis);
+            st.counter[axis] -= step_event_count;
+        }
+    }
+    st.step_outbits = step_outbits;
+
+    // Advance through the raster pixels in step with the dominant axis
+    if (st.raster_inc) {
+        st.raster_counter += st.raster_inc;
+        if (st.raster_counter > step_event_count) {
+            st.raster_counter -= step_event_count;
+            if (++st.raster_index < st.exec_block->raster_count) {
+                spindle->setSpeedfromISR(raster_power(st.exec_block, st.raster_index));
+            }
         }
     }
 
@@ -275,13 +385,73 @@ bool IRAM_ATTR Stepper::pulse_func() {
     if (st.step_count == 0) {
         // Segment is complete. Discard current segment and advance segment indexing.
         st.exec_segment     = NULL;
-        segment_buffer_tail = segment_buffer_tail >= (config->_stepping->_segments - 1) ? 0 : segment_buffer_tail + 1;
+        segment_buffer_tail = segment_buffer_tail >= isr.last_segment ? 0 : segment_buffer_tail + 1;
     }
 
-    config->_axes->unstep();
+    isr.axes->unstep();
     return true;
 }
 
+static bool (*pulse_kernel_func)() = nullptr;
+
+static void select_pulse_kernel() {
+    isr.axes         = config->_axes;
+    isr.stepping     = config->_stepping;
+    isr.probe        = config->_probe;
+    isr.last_segment = config->_stepping->_segments - 1;
+
+    static_assert(MAX_N_AXIS == 6, "Add pulse kernels for the new axis count");
+    static bool (*const kernels[MAX_N_AXIS])() = {
+        pulse_kernel<1>, pulse_kernel<2>, pulse_kernel<3>, pulse_kernel<4>, pulse_kernel<5>, pulse_kernel<6>,
+    };
+    auto n_axis       = config->_axes->_numberAxis;
+    pulse_kernel_func = kernels[(n_axis < 1 ? 1 : n_axis) - 1];
+}
+
+bool IRAM_ATTR Stepper::pulse_func() {
+    return pulse_kernel_func();
+}
+
+// Runs the Bresenham portion of pulse_func() over a whole segment with no pin output.
+// Only valid while the stepper timer is stopped; used by the native pipeline benchmark test.
+uint32_t Stepper::simulate_segment() {
+    if (segment_buffer_head == segment_buffer_tail) {
+        return 0;
+    }
+    auto n_axis = config->_axes->_numberAxis;
+
+    st.exec_segment = &segment_buffer[segment_buffer_tail];
+    if (st.exec_block_index != st.exec_segment->st_block_index || st.exec_block == NULL) {
+        st.exec_block_index = st.exec_segment->st_block_index;
+        st.exec_block       = &st_block_buffer[st.exec_block_index];
+        if (st.exec_block->raster_count) {
+            Raster::release_before({ st.exec_block->raster_start, st.exec_block->raster_count, st.exec_block->raster_gen });
+        }
+        for (int axis = 0; axis < n_axis; axis++) {
+            st.counter[axis] = st.exec_block->step_event_count >> 1;
+        }
+    }
+    for (int axis = 0; axis < n_axis; axis++) {
+        st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
+    }
+
+    uint32_t ticks = st.exec_segment->n_step;
+    for (uint32_t tick = 0; tick < ticks; tick++) {
+        st.step_outbits = 0;
+        for (int axis = 0; axis < n_axis; axis++) {
+            st.counter[axis] += st.steps[axis];
+            if (st.counter[axis] > st.exec_block->step_event_count) {
+                set_bitnum(st.step_outbits, axis);
+                st.counter[axis] -= st.exec_block->step_event_count;
+            }
+        }
+    }
+
+    st.exec_segment     = NULL;
+    segment_buffer_tail = segment_buffer_tail >= (config->_stepping->_segments - 1) ? 0 : segment_buffer_tail + 1;
+    return ticks;
+}
+
 // enabled. Startup init and limits call this function but shouldn't start the cycle.
 void Stepper::wake_up() {
     if (awake) {
@@ -320,6 +490,10 @@ void Stepper::reset() {
     segment_next_head   = 1;
     st.step_outbits     = 0;
     st.dir_outbits      = 0;  // Initialize direction bits to default.
+    underruns           = 0;
+
+    // Forget the raster pixels of any blocks that will not be executed
+    Raster::reset();
     // TODO do we need to turn step pins off?
 }
 
@@ -327,7 +501,7 @@ void Stepper::reset() {
 bool Stepper::update_plan_block_parameters() {
     if (pl_block != NULL) {  // Ignore if at start of a new block.
         prep.recalculate_flag.recalculate = 1;
-        pl_block->entry_speed_sqr         = prep.current_speed * prep.current_speed;  // Update entry speed.
+        pl_profile->entry_speed_sqr       = prep.current_speed * prep.current_speed;  // Update entry speed.
         pl_block                          = NULL;  // Flag prep_segment() to load and check active velocity profile.
         return true;
     }
@@ -374,6 +548,28 @@ static uint8_t next_block_index(uint8_t block_index) {
     return block_index == (config->_stepping->_segments - 1) ? 0 : block_index;
 }
 
+// Returns the execution time for the next segment.  With adaptive segments, the
+// time is doubled while fewer than a quarter of the segments are queued, so the
+// main loop can catch up after being held off by other work, and halved while at
+// least half are queued, for a finer velocity profile.  Long segments only ever
+// sit in the first quarter of the buffer and short ones fill the second half, so
+// the motion queued ahead of a feed hold is never longer than with fixed segments.
+static float segment_time() {
+    auto stepping = config->_stepping;
+    if (!stepping->_adaptiveSegments) {
+        return DT_SEGMENT;
+    }
+    uint32_t n      = stepping->_segments;
+    uint32_t queued = (segment_buffer_head + n - segment_buffer_tail) % n;
+    if (queued < n / 4) {
+        return 2.0f * DT_SEGMENT;
+    }
+    if (queued >= n / 2) {
+        return 0.5f * DT_SEGMENT;
+    }
+    return DT_SEGMENT;
+}
+
 /* Prepares step segment buffer. Continuously called from main program.
 
    The segment buffer is an intermediary buffer interface between the execution of steps
@@ -406,6 +602,7 @@ void Stepper::prep_buffer() {
             if (pl_block == NULL) {
                 return;  // No planner blocks. Exit.
             }
+            pl_profile = plan_get_profile(pl_block);
 
             // Check if we need to only recompute the velocity profile or load a new block.
             if (prep.recalculate_flag.recalculate) {
@@ -422,6 +619,15 @@ void Stepper::prep_buffer() {
                 // segment buffer finishes the prepped block, but the stepper ISR is still executing it.
                 st_prep_block                 = &st_block_buffer[prep.st_block_index];
                 st_prep_block->direction_bits = pl_block->direction_bits;
+
+                st_prep_block->raster_start = pl_block->raster.start;
+                st_prep_block->raster_count = pl_block->raster.count;
+                st_prep_block->raster_gen   = pl_block->raster.gen;
+                if (pl_block->raster.count) {
+                    uint32_t full = pl_block->spindle == SpindleState::Disable ? 0 : spindle->mapSpeed(pl_block->spindle_speed);
+                    st_prep_block->raster       = Raster::pixels(pl_block->raster);
+                    st_prep_block->raster_scale = uint32_t(uint64_t(full) * 256 / 255);
+                }
                 uint8_t idx;
                 auto    n_axis = config->_axes->_numberAxis;
 
@@ -435,26 +641,32 @@ void Stepper::prep_buffer() {
 
                 // Initialize segment buffer data for generating the segments.
                 prep.steps_remaining  = (float)pl_block->step_event_count;
-                prep.step_per_mm      = prep.steps_remaining / pl_block->millimeters;
+                prep.step_per_mm      = prep.steps_remaining / pl_profile->millimeters;
                 prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR / prep.step_per_mm;
                 prep.dt_remainder     = 0.0;  // Reset for new segment block
                 if ((sys.step_control.executeHold) || prep.recalculate_flag.decelOverride) {
                     // New block loaded mid-hold. Override planner block entry speed to enforce deceleration.
                     prep.current_speed                  = prep.exit_speed;
-                    pl_block->entry_speed_sqr           = prep.exit_speed * prep.exit_speed;
+                    pl_profile->entry_speed_sqr         = prep.exit_speed * prep.exit_speed;
                     prep.recalculate_flag.decelOverride = 0;
                 } else {
-                    prep.current_speed = sqrtf(pl_block->entry_speed_sqr);
+                    prep.current_speed = sqrtf(pl_profile->entry_speed_sqr);
                 }
 
                 // prep.inv_rate is only used if is_pwm_rate_adjusted is true
                 st_prep_block->is_pwm_rate_adjusted = false;  // set default value
+                st_prep_block->rate_ref_ticks       = 0;
 
                 if (spindle->isRateAdjusted()) {
                     if (pl_block->spindle == SpindleState::Ccw) {
                         // Pre-compute inverse programmed rate to speed up PWM updating per step segment.
                         prep.inv_rate                       = 1.0f / pl_block->programmed_rate;
                         st_prep_block->is_pwm_rate_adjusted = true;
+                        if (spindle->isrRateAdjusted()) {
+                            // The ISR compares each segment's timer ticks per step with this
+                            float ref = (Machine::Stepping::fStepperTimer * 60.0f) * prep.inv_rate / prep.step_per_mm;
+                            st_prep_block->rate_ref_ticks = ref < float(UINT32_MAX) ? uint32_t(ref) : UINT32_MAX;
+                        }
                     }
                 }
             }
@@ -465,16 +677,16 @@ void Stepper::prep_buffer() {
              hold, override the planner velocities and decelerate to the target exit speed.
             */
             prep.mm_complete  = 0.0;  // Default velocity profile complete at 0.0mm from end of block.
-            float inv_2_accel = 0.5f / pl_block->acceleration;
+            float inv_2_accel = 0.5f / pl_profile->acceleration;
             if (sys.step_control.executeHold) {  // [Forced Deceleration to Zero Velocity]
                 // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
                 // the planner block profile, enforcing a deceleration to zero speed.
                 prep.ramp_type = RAMP_DECEL;
                 // Compute decelerate distance relative to end of block.
-                float decel_dist = pl_block->millimeters - inv_2_accel * pl_block->entry_speed_sqr;
+                float decel_dist = pl_profile->millimeters - inv_2_accel * pl_profile->entry_speed_sqr;
                 if (decel_dist < 0.0) {
                     // Deceleration through entire planner block. End of feed hold is not in this block.
-                    prep.exit_speed = sqrtf(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
+                    prep.exit_speed = sqrtf(pl_profile->entry_speed_sqr - 2 * pl_profile->acceleration * pl_profile->millimeters);
                 } else {
                     prep.mm_complete = decel_dist;  // End of feed hold.
                     prep.exit_speed  = 0.0;
@@ -482,7 +694,7 @@ void Stepper::prep_buffer() {
             } else {  // [Normal Operation]
                 // Compute or recompute velocity profile parameters of the prepped planner block.
                 prep.ramp_type        = RAMP_ACCEL;  // Initialize as acceleration ramp.
-                prep.accelerate_until = pl_block->millimeters;
+                prep.accelerate_until = pl_profile->millimeters;
                 float exit_speed_sqr;
                 float nominal_speed;
                 if (sys.step_control.executeSysMotion) {
@@ -498,15 +710,15 @@ void Stepper::prep_buffer() {
 
                 nominal_speed            = plan_compute_profile_nominal_speed(pl_block);
                 float nominal_speed_sqr  = nominal_speed * nominal_speed;
-                float intersect_distance = 0.5f * (pl_block->millimeters + inv_2_accel * (pl_block->entry_speed_sqr - exit_speed_sqr));
-                if (pl_block->entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
-                    prep.accelerate_until = pl_block->millimeters - inv_2_accel * (pl_block->entry_speed_sqr - nominal_speed_sqr);
+                float intersect_distance = 0.5f * (pl_profile->millimeters + inv_2_accel * (pl_profile->entry_speed_sqr - exit_speed_sqr));
+                if (pl_profile->entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
+                    prep.accelerate_until = pl_profile->millimeters - inv_2_accel * (pl_profile->entry_speed_sqr - nominal_speed_sqr);
                     if (prep.accelerate_until <= 0.0) {  // Deceleration-only.
                         prep.ramp_type = RAMP_DECEL;
-                        // prep.decelerate_after = pl_block->millimeters;
+                        // prep.decelerate_after = pl_profile->millimeters;
                         // prep.maximum_speed = prep.current_speed;
                         // Compute override block exit speed since it doesn't match the planner exit speed.
-                        prep.exit_speed = sqrtf(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
+                        prep.exit_speed = sqrtf(pl_profile->entry_speed_sqr - 2 * pl_profile->acceleration * pl_profile->millimeters);
                         prep.recalculate_flag.decelOverride = 1;  // Flag to load next block as deceleration override.
                         // TODO: Determine correct handling of parameters in deceleration-only.
                         // Can be tricky since entry speed will be current speed, as in feed holds.
@@ -518,26 +730,26 @@ void Stepper::prep_buffer() {
                         prep.ramp_type        = RAMP_DECEL_OVERRIDE;
                     }
                 } else if (intersect_distance > 0.0) {
-                    if (intersect_distance < pl_block->millimeters) {  // Either trapezoid or triangle types
+                    if (intersect_distance < pl_profile->millimeters) {  // Either trapezoid or triangle types
                         // NOTE: For acceleration-cruise and cruise-only types, following calculation will be 0.0.
                         prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
                         if (prep.decelerate_after < intersect_distance) {  // Trapezoid type
                             prep.maximum_speed = nominal_speed;
-                            if (pl_block->entry_speed_sqr == nominal_speed_sqr) {
+                            if (pl_profile->entry_speed_sqr == nominal_speed_sqr) {
                                 // Cruise-deceleration or cruise-only type.
                                 prep.ramp_type = RAMP_CRUISE;
                             } else {
                                 // Full-trapezoid or acceleration-cruise types
-                                prep.accelerate_until -= inv_2_accel * (nominal_speed_sqr - pl_block->entry_speed_sqr);
+                                prep.accelerate_until -= inv_2_accel * (nominal_speed_sqr - pl_profile->entry_speed_sqr);
                             }
                         } else {  // Triangle type
                             prep.accelerate_until = intersect_distance;
                             prep.decelerate_after = intersect_distance;
-                            prep.maximum_speed    = sqrtf(2.0f * pl_block->acceleration * intersect_distance + exit_speed_sqr);
+                            prep.maximum_speed    = sqrtf(2.0f * pl_profile->acceleration * intersect_distance + exit_speed_sqr);
                         }
                     } else {  // Deceleration-only type
                         prep.ramp_type = RAMP_DECEL;
-                        // prep.decelerate_after = pl_block->millimeters;
+                        // prep.decelerate_after = pl_profile->millimeters;
                         // prep.maximum_speed = prep.current_speed;
                     }
                 } else {  // Acceleration-only type
@@ -570,12 +782,13 @@ void Stepper::prep_buffer() {
           the end of planner block (typical) or mid-block at the end of a forced deceleration,
           such as from a feed hold.
         */
-        float dt_max   = DT_SEGMENT;                                // Maximum segment time
-        float dt       = 0.0;                                       // Initialize segment time
-        float time_var = dt_max;                                    // Time worker variable
+        float dt_segment = segment_time();                          // Nominal segment time
+        float dt_max     = dt_segment;                              // Maximum segment time
+        float dt         = 0.0;                                     // Initialize segment time
+        float time_var   = dt_max;                                  // Time worker variable
         float mm_var;                                               // mm-Distance worker variable
         float speed_var;                                            // Speed worker variable
-        float mm_remaining = pl_block->millimeters;                 // New segment distance from end of block.
+        float mm_remaining = pl_profile->millimeters;               // New segment distance from end of block.
         float minimum_mm   = mm_remaining - prep.req_mm_increment;  // Guarantee at least one step.
 
         if (minimum_mm < 0.0) {
@@ -585,13 +798,13 @@ void Stepper::prep_buffer() {
         do {
             switch (prep.ramp_type) {
                 case RAMP_DECEL_OVERRIDE:
-                    speed_var = pl_block->acceleration * time_var;
+                    speed_var = pl_profile->acceleration * time_var;
                     mm_var    = time_var * (prep.current_speed - 0.5f * speed_var);
                     mm_remaining -= mm_var;
                     if ((mm_remaining < prep.accelerate_until) || (mm_var <= 0)) {
                         // Cruise or cruise-deceleration types only for deceleration override.
                         mm_remaining       = prep.accelerate_until;  // NOTE: 0.0 at EOB
-                        time_var           = 2.0f * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
+                        time_var           = 2.0f * (pl_profile->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
                         prep.ramp_type     = RAMP_CRUISE;
                         prep.current_speed = prep.maximum_speed;
                     } else {  // Mid-deceleration override ramp.
@@ -600,12 +813,12 @@ void Stepper::prep_buffer() {
                     break;
                 case RAMP_ACCEL:
                     // NOTE: Acceleration ramp only computes during first do-while loop.
-                    speed_var = pl_block->acceleration * time_var;
+                    speed_var = pl_profile->acceleration * time_var;
                     mm_remaining -= time_var * (prep.current_speed + 0.5f * speed_var);
                     if (mm_remaining < prep.accelerate_until) {  // End of acceleration ramp.
                         // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
                         mm_remaining = prep.accelerate_until;  // NOTE: 0.0 at EOB
-                        time_var     = 2.0f * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
+                        time_var     = 2.0f * (pl_profile->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
                         if (mm_remaining == prep.decelerate_after) {
                             prep.ramp_type = RAMP_DECEL;
                         } else {
@@ -632,7 +845,7 @@ void Stepper::prep_buffer() {
                     break;
                 default:  // case RAMP_DECEL:
                     // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
-                    speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
+                    speed_var = pl_profile->acceleration * time_var;  // Used as delta speed (mm/min)
                     if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
                         // Compute distance from end of segment to end of block.
                         mm_var = mm_remaining - time_var * (prep.current_speed - 0.5f * speed_var);  // (mm)
@@ -655,7 +868,7 @@ void Stepper::prep_buffer() {
                 if (mm_remaining > minimum_mm) {  // Check for very slow segments with zero steps.
                     // Increase segment time to ensure at least one step in segment. Override and loop
                     // through distance calculations until minimum_mm or mm_complete.
-                    dt_max += DT_SEGMENT;
+                    dt_max += dt_segment;
                     time_var = dt_max - dt;
                 } else {
                     break;  // **Complete** Exit loop. Segment execution time maxed.
@@ -685,8 +898,14 @@ void Stepper::prep_buffer() {
             }
             sys.step_control.updateSpindleSpeed = false;
         }
-        prep_segment->spindle_speed     = prep.current_spindle_speed;
-        prep_segment->spindle_dev_speed = spindle->mapSpeed(prep.current_spindle_speed);  // Reload segment PWM value
+        prep_segment->spindle_speed = prep.current_spindle_speed;
+        if (st_prep_block->rate_ref_ticks) {
+            // The ISR scales the power by the segment's step rate
+            prep_segment->spindle_fraction = spindle->speedFraction(pl_block->spindle_speed);
+            sys.spindle_speed              = prep.current_spindle_speed * sys.spindle_speed_ovr / 100;
+        } else {
+            prep_segment->spindle_dev_speed = spindle->mapSpeed(prep.current_spindle_speed);  // Reload segment PWM value
+        }
 
         /* -----------------------------------------------------------------------------------
            Compute segment step rate, steps to execute, and apply necessary rate corrections.
@@ -754,9 +973,9 @@ void Stepper::prep_buffer() {
         segment_buffer_head = lastseg;
 
         // Update the appropriate planner and segment data.
-        pl_block->millimeters = mm_remaining;
-        prep.steps_remaining  = n_steps_remaining;
-        prep.dt_remainder     = (n_steps_remaining - step_dist_remaining) * inv_rate;
+        pl_profile->millimeters = mm_remaining;
+        prep.steps_remaining    = n_steps_remaining;
+        prep.dt_remainder       = (n_steps_remaining - step_dist_remaining) * inv_rate;
         // Check for exit conditions and flag to load next planner block.
         if (mm_remaining == prep.mm_complete) {
             // End of planner block or forced-termination. No more distance to be executed.
@@ -45,5 +45,12 @@ namespace Stepper {
     // Called by realtime status reporting if realtime rate reporting is enabled in config.h.
     float get_realtime_rate();
 
+    // Executes the next step segment without driving any pins, standing in for the stepper ISR.
+    // Returns the number of ISR ticks the segment would have taken, or 0 if the buffer is empty.
+    uint32_t simulate_segment();
+
     extern uint32_t isr_count;
+
+    // Times the segment buffer ran dry while motion was queued, since the last reset
+    extern uint32_t underruns;
 }
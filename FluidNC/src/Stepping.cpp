@@ -140,6 +140,7 @@ namespace Machine {
         handler.item("dir_delay_us", _directionDelayUsecs, 0, 10);
         handler.item("disable_delay_us", _disableDelayUsecs, 0, 10);
         handler.item("segments", _segments, 6, 20);
+        handler.item("adaptive_segments", _adaptiveSegments);
     }
 
     void Stepping::afterParse() {
@@ -40,6 +40,9 @@ namespace Machine {
 
         size_t _segments = 12;
 
+        // Vary the segment time with the number of queued segments; see segment_time() in Stepper.cpp
+        bool _adaptiveSegments = false;
+
         uint32_t _idleMsecs           = 255;
         uint32_t _pulseUsecs          = 4;
         uint32_t _directionDelayUsecs = 0;
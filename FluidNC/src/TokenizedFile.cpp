@@ -0,0 +1,169 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "TokenizedFile.h"
+
+#include "GCode.h"      // collapseGCode(), TOKENIZED_LINE
+#include "NutsBolts.h"  // read_float()
+#include "Logging.h"
+
+#include <cstring>
+
+const char* TokenizedFile::extension = ".gct";
+
+static const char magic[4] = { 'F', 'N', 'C', 'T' };
+
+bool TokenizedFile::is_tokenized(const char* path) {
+    size_t len = strlen(path);
+    size_t ext = strlen(extension);
+    return len > ext && strcasecmp(path + len - ext, extension) == 0;
+}
+
+TokenizedFile::TokenizedFile(const char* fsname, const char* path, WebUI::AuthenticationLevel auth_level, Channel& channel) :
+    InputFile(fsname, path, auth_level, channel) {
+    uint8_t header[8];
+    if (!read_bytes(header, sizeof(header)) || memcmp(header, magic, sizeof(magic)) || header[4] != version) {
+        log_error(path << " is not a tokenized GCode file");
+        throw Error::FsFailedRead;
+    }
+}
+
+Error TokenizedFile::readLine(char* line, int maxlen) {
+    uint8_t head[5];
+    if (!read_bytes(head, sizeof(head))) {
+        line[0] = '\0';
+        return Error::Eof;
+    }
+    memcpy(&_line_num, head, sizeof(_line_num));
+    uint8_t count = head[4];
+
+    if (count == textRecord) {
+        uint8_t len;
+        if (!read_bytes(&len, 1) || len >= maxlen) {
+            return Error::FsFailedRead;
+        }
+        if (!read_bytes(line, len)) {
+            return Error::FsFailedRead;
+        }
+        line[len] = '\0';
+        return Error::Ok;
+    }
+
+    size_t len = count * TOKENIZED_WORD_SIZE;
+    if (count > maxWords || len + 2 > size_t(maxlen)) {
+        return Error::FsFailedRead;
+    }
+    line[0] = TOKENIZED_LINE;
+    line[1] = count;
+    return read_bytes(line + 2, len) ? Error::Ok : Error::FsFailedRead;
+}
+
+void TokenizedFile::print_line(const char* line, Print& out) {
+    uint8_t        count = line[1];
+    const uint8_t* word  = reinterpret_cast<const uint8_t*>(line + 2);
+    for (int i = 0; i < count; ++i, word += TOKENIZED_WORD_SIZE) {
+        float value;
+        memcpy(&value, word + 1, sizeof(value));
+        out << char(word[0]) << value;
+    }
+}
+
+static void write_text(FileStream& dst, uint32_t line_num, const char* text) {
+    uint8_t record[6];
+    memcpy(record, &line_num, sizeof(line_num));
+    record[4] = TokenizedFile::textRecord;
+    record[5] = uint8_t(strlen(text));
+    dst.write(record, sizeof(record));
+    dst.write(reinterpret_cast<const uint8_t*>(text), record[5]);
+}
+
+// Splits a collapsed line into words.  Returns the number of words,
+// or -1 if the line cannot be tokenized.
+static int tokenize(const char* line, uint8_t* words) {
+    size_t char_counter = 0;
+    int    count        = 0;
+    while (line[char_counter]) {
+        char letter = line[char_counter++];
+        if (letter < 'A' || letter > 'Z' || size_t(count) == TokenizedFile::maxWords) {
+            return -1;
+        }
+        float value;
+        if (!read_float(line, &char_counter, &value)) {
+            return -1;
+        }
+        uint8_t* word = words + count++ * TOKENIZED_WORD_SIZE;
+        word[0]       = letter;
+        memcpy(word + 1, &value, sizeof(value));
+    }
+    return count;
+}
+
+Error TokenizedFile::convert(const char* fsname, const char* path, Channel& out) {
+    std::string dstPath(path);
+    auto        dot = dstPath.rfind('.');
+    if (dot != std::string::npos && dstPath.find('/', dot) == std::string::npos) {
+        dstPath.erase(dot);
+    }
+    dstPath += extension;
+    if (is_tokenized(path)) {
+        log_error_to(out, path << " is already tokenized");
+        return Error::InvalidValue;
+    }
+
+    InputFile*  src = nullptr;
+    FileStream* dst = nullptr;
+    try {
+        src = new InputFile(fsname, path, WebUI::AuthenticationLevel::LEVEL_GUEST, out);
+        dst = new FileStream(dstPath.c_str(), "w", fsname);
+    } catch (Error err) {
+        delete src;
+        return err;
+    }
+
+    uint8_t header[8] = { magic[0], magic[1], magic[2], magic[3], version, 0, 0, 0 };
+    dst->write(header, sizeof(header));
+
+    char     line[Channel::maxLine];
+    char     text[Channel::maxLine];
+    uint8_t  record[5 + maxWords * TOKENIZED_WORD_SIZE];
+    uint32_t nBlocks = 0;
+    uint32_t nText   = 0;
+    Error    err;
+    while ((err = src->readLine(line, Channel::maxLine - 1)) == Error::Ok) {
+        uint32_t line_num = src->getLineNumber();
+
+        // Commands and messages keep their text so they run exactly as before
+        if (line[0] == '$' || line[0] == '[' || (strchr(line, '(') && strstr(line, "MSG"))) {
+            write_text(*dst, line_num, line);
+            ++nText;
+            continue;
+        }
+
+        strcpy(text, line);
+        collapseGCode(line);
+        if (!line[0]) {
+            continue;
+        }
+        int count = tokenize(line, record + 5);
+        if (count < 0) {
+            // Let the parser report the problem when the file is run
+            write_text(*dst, line_num, text);
+            ++nText;
+            continue;
+        }
+        memcpy(record, &line_num, sizeof(line_num));
+        record[4] = uint8_t(count);
+        dst->write(record, 5 + count * TOKENIZED_WORD_SIZE);
+        ++nBlocks;
+    }
+    uint32_t nLines = src->getLineNumber() - 1;
+    delete src;
+    delete dst;
+
+    if (err != Error::Eof) {
+        log_error_to(out, "Tokenizing " << path << " failed: " << errorString(err));
+        return err;
+    }
+    log_info_to(out, "Tokenized " << nLines << " lines to " << dstPath << ": " << nBlocks << " blocks, " << nText << " text lines");
+    return Error::Ok;
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  TokenizedFile.h - runs GCode files that were parsed ahead of time
+
+  Production jobs are often run many times.  Rather than collapsing each
+  line and converting every number with read_float() on every run, a .nc
+  file can be converted once, either with $SD/Tokenize=<path> or on the
+  host with gcode-tokenize.py, into a .gct file of letter/value words.
+  TokenizedFile hands those words to gc_execute_line() as a TOKENIZED_LINE,
+  so the parser goes straight to checking and executing the block.
+
+  File layout, all values little-endian:
+
+    header    'F' 'N' 'C' 'T' <version> 0 0 0
+    record    uint32 line number in the source file
+              uint8  word count, or textRecord
+              words  count * (uint8 letter, float32 value)
+          or  uint8  length, followed by the text of the line
+
+  Lines that are not plain GCode words - $ and [ commands, (MSG comments,
+  lines with more words than fit in a TOKENIZED_LINE, and lines with
+  errors - are stored as text and run through the normal path, so errors
+  are reported exactly as they would be for the source file.  Empty and
+  comment-only lines are dropped; line numbers still refer to the source.
+*/
+
+#include "InputFile.h"
+#include "GCode.h"  // TOKENIZED_WORD_SIZE
+
+class TokenizedFile : public InputFile {
+public:
+    static const char*   extension;  // ".gct"
+    static const uint8_t version    = 1;
+    static const uint8_t textRecord = 0xff;
+    static const size_t  maxWords   = (Channel::maxLine - 2) / TOKENIZED_WORD_SIZE;
+
+    static bool is_tokenized(const char* path);
+
+    // Converts the GCode file at path to a tokenized file next to it,
+    // with the extension replaced by ".gct"
+    static Error convert(const char* fsname, const char* path, Channel& out);
+
+    // Writes a TOKENIZED_LINE back out as GCode text
+    static void print_line(const char* line, Print& out);
+
+    // Throws an Error if the file cannot be opened or is not tokenized
+    TokenizedFile(const char* fsname, const char* path, WebUI::AuthenticationLevel auth_level, Channel& channel);
+
+    Error readLine(char* line, int maxlen) override;
+};
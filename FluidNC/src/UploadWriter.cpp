@@ -0,0 +1,213 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "UploadWriter.h"
+
+#include "FileStream.h"
+#include "Config.h"  // SUPPORT_TASK_CORE
+#include "Logging.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <mbedtls/md.h>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace UploadWriter {
+    struct Buffer {
+        uint8_t data[bufferSize];
+        size_t  len;
+    };
+
+    static Buffer* buffers = nullptr;
+
+    // Free-running counters; the buffer index is counter % nBuffers.
+    // The receiver fills the buffer at _head, the task writes them at _tail.
+    static std::atomic<uint32_t> _head;
+    static std::atomic<uint32_t> _tail;
+    static std::atomic<bool>     _failed;
+    static size_t                _fill = 0;  // Bytes in the buffer at _head
+
+    static FileStream* volatile _file = nullptr;
+
+    static bool                 _hashing = false;
+    static mbedtls_md_context_t _sha;
+
+    static int64_t  _startUs = 0;
+    static uint64_t _bytes   = 0;
+
+    static TaskHandle_t          writerTask   = nullptr;
+    static volatile TaskHandle_t receiverTask = nullptr;
+
+    // Cumulative since boot
+    static uint32_t nUploads   = 0;
+    static uint32_t nFailures  = 0;
+    static uint64_t nBytes     = 0;
+    static uint32_t nStalls    = 0;
+    static uint32_t maxWriteUs = 0;
+    static uint32_t maxWaitUs  = 0;
+    static uint32_t lastKBps   = 0;
+
+    static void write_loop(void* unused) {
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            while (_tail != _head) {
+                Buffer& buffer = buffers[_tail % nBuffers];
+                if (!_failed) {
+                    int64_t start = esp_timer_get_time();
+                    if (_file->write(buffer.data, buffer.len) != buffer.len) {
+                        _failed = true;
+                    }
+                    maxWriteUs = std::max(maxWriteUs, uint32_t(esp_timer_get_time() - start));
+                }
+                ++_tail;
+                TaskHandle_t receiver = receiverTask;
+                if (receiver) {
+                    xTaskNotifyGive(receiver);
+                }
+            }
+        }
+    }
+
+    // Waits until no more than queued buffers are waiting to be written,
+    // returning how long that took
+    static uint32_t wait_for(uint32_t queued) {
+        int64_t waitStart = 0;
+        while ((_head - _tail) > queued) {
+            if (!waitStart) {
+                waitStart = esp_timer_get_time();
+            }
+            ulTaskNotifyTake(pdTRUE, 1);
+        }
+        return waitStart ? uint32_t(esp_timer_get_time() - waitStart) : 0;
+    }
+
+    // Hands the buffer at _head to the task
+    static void publish() {
+        buffers[_head % nBuffers].len = _fill;
+        _fill                         = 0;
+        ++_head;
+        xTaskNotifyGive(writerTask);
+    }
+
+    static void release() {
+        if (_hashing) {
+            mbedtls_md_free(&_sha);
+            _hashing = false;
+        }
+        _file        = nullptr;
+        receiverTask = nullptr;
+        delete[] buffers;  // Uploads are rare, so the buffers do not stay allocated
+        buffers = nullptr;
+    }
+
+    bool start(FileStream* file, bool hash) {
+        if (_file) {
+            return false;
+        }
+        if (!writerTask) {
+            xTaskCreatePinnedToCore(write_loop,        // task
+                                    "upload",          // name for task
+                                    4096,              // size of task stack
+                                    0,                 // parameters
+                                    1,                 // priority
+                                    &writerTask,       // task handle
+                                    SUPPORT_TASK_CORE  // core
+            );
+        }
+        buffers = new (std::nothrow) Buffer[nBuffers];
+        if (!buffers) {
+            return false;
+        }
+        _hashing = hash;
+        if (_hashing) {
+            mbedtls_md_init(&_sha);
+            mbedtls_md_setup(&_sha, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+            mbedtls_md_starts(&_sha);
+        }
+        _head        = 0;
+        _tail        = 0;
+        _failed      = false;
+        _fill        = 0;
+        _bytes       = 0;
+        _startUs     = esp_timer_get_time();
+        receiverTask = xTaskGetCurrentTaskHandle();
+        _file        = file;
+        ++nUploads;
+        return true;
+    }
+
+    bool write(const uint8_t* data, size_t length) {
+        if (!_file || _failed) {
+            return false;
+        }
+        if (_hashing) {
+            mbedtls_md_update(&_sha, data, length);
+        }
+        _bytes += length;
+        nBytes += length;
+        while (length) {
+            if (_fill == 0) {
+                // The buffer at _head must have been written
+                uint32_t waitUs = wait_for(nBuffers - 1);
+                if (waitUs) {
+                    ++nStalls;
+                    maxWaitUs = std::max(maxWaitUs, waitUs);
+                }
+            }
+            size_t n = std::min(length, bufferSize - _fill);
+            memcpy(buffers[_head % nBuffers].data + _fill, data, n);
+            _fill += n;
+            data += n;
+            length -= n;
+            if (_fill == bufferSize) {
+                publish();
+            }
+        }
+        return !_failed;
+    }
+
+    bool finish(uint8_t sha[32]) {
+        if (!_file) {
+            return false;
+        }
+        if (_fill) {
+            publish();
+        }
+        wait_for(0);
+        if (_hashing) {
+            mbedtls_md_finish(&_sha, sha);
+        }
+
+        uint32_t ms = std::max(int64_t(1), (esp_timer_get_time() - _startUs) / 1000);
+        lastKBps    = uint32_t(_bytes * 1000 / 1024 / ms);
+        bool ok     = !_failed;
+        if (ok) {
+            log_info("Upload " << _bytes << " bytes in " << ms << "ms, " << lastKBps << " KB/s");
+        } else {
+            ++nFailures;
+        }
+        release();
+        return ok;
+    }
+
+    void abort() {
+        if (!_file) {
+            return;
+        }
+        _failed = true;  // The task skips whatever is still queued
+        wait_for(0);
+        ++nFailures;
+        release();
+    }
+
+    void report_stats(Channel& out) {
+        log_to(out,
+               "[UPLOAD:",
+               "uploads=" << nUploads << " failures=" << nFailures << " bytes=" << nBytes << " stalls=" << nStalls << " maxWrite=" << maxWriteUs
+                          << "us maxWait=" << maxWaitUs << "us last=" << lastKBps << "KB/s");
+    }
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  UploadWriter.h - writes a web upload to its file in the background
+
+  The web server used to write each received chunk to the file itself,
+  sleeping a tick per chunk, and then read the whole file back to hash
+  it.  The upload data is now copied into one of two buffers while the
+  other is written by a task pinned to SUPPORT_TASK_CORE, so receiving
+  and writing overlap.  The receiver only waits when both buffers are
+  full.  The SHA-256 for HashFS is computed as the data arrives.
+
+  One upload can be written at a time.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+class FileStream;
+class Channel;
+
+namespace UploadWriter {
+    static const size_t bufferSize = 8192;
+    static const int    nBuffers   = 2;
+
+    // Starts writing to file, which stays owned by the caller.  If hash
+    // is true, the SHA-256 of the data is computed for finish().
+    bool start(FileStream* file, bool hash);
+
+    // Queues data for writing.  Returns false once a write has failed.
+    bool write(const uint8_t* data, size_t length);
+
+    // Writes out the rest of the data and logs the throughput.  sha
+    // receives the hash if it was requested.  Returns false if any write
+    // failed.  The file can be closed afterwards.
+    bool finish(uint8_t sha[32]);
+
+    // Drops the queued data; must be called before the file is closed
+    void abort();
+
+    void report_stats(Channel& out);
+}
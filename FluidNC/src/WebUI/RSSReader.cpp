@@ -68,7 +68,7 @@ namespace WebUI {
     // Constructor
     RSSReader::RSSReader() {
 
-        _rss_feed           = new struct ListType;
+        _rss_feed           = new struct ListType();
         _web_server         = DEFAULT_RSS_WEB_SERVER;
         _web_rss_address    = DEFAULT_RSS_ADDRESS;
         _refresh_period_sec = DEFAULT_RSS_REFRESH_SEC;
@@ -511,7 +511,7 @@ namespace WebUI {
     }
 
     // Downloads the specified RSS feed link to SD card
-    void RSSReader::download_file(char *link, char *filename) {
+    void RSSReader::download_file(const char *link, const char *filename) {
 
         WiFiClientSecure download_client;
         String server, address;
@@ -617,7 +617,7 @@ namespace WebUI {
                 delete(file);
 
                 // Update the files list on SD card and exit to main menu
-                sd_populate_files_menu();
+                config->_sdCard->updateMenu();
                 if (config->_oled) {
                     config->_oled->_menu->exit_submenu();
                 }
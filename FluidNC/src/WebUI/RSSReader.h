@@ -42,10 +42,11 @@ namespace WebUI {
         void            handle();
         bool            started();
         String          get_url();
-        void            download_file(char *link, char *filename);
+        void            download_file(const char *link, const char *filename);
         time_t          get_last_update_time() { return _last_update_time; };
         void            sync() { _refresh_start_ms = 0; };
-        ListNodeType    *get_rss_feed() { return _rss_feed->head; };
+        ListNodeType    *get_rss_feed() { return node(_rss_feed, _rss_feed->head); };
+        ListNodeType    *get_next(ListNodeType *entry) { return next(_rss_feed, entry); };
 
         ~RSSReader();
 
@@ -34,6 +34,8 @@
 #    include "src/WebUI/JSONEncoder.h"
 
 #    include "src/HashFS.h"
+#    include "src/SDIndex.h"
+#    include "src/UploadWriter.h"
 #    include <list>
 
 namespace WebUI {
@@ -920,6 +922,7 @@ namespace WebUI {
                 if (stdfs::remove(fpath / filename, ec)) {
                     sstatus = filename + " deleted";
                     HashFS::delete_file(fpath / filename);
+                    sdIndex.removed(fpath / filename);
 
                 } else {
                     sstatus = "Cannot delete ";
@@ -931,6 +934,7 @@ namespace WebUI {
                 int count = stdfs::remove_all(dirpath, ec);
                 if (count > 0) {
                     sstatus = filename + " deleted";
+                    sdIndex.removed(dirpath);
                 } else {
                     log_debug("remove_all returned " << count);
                     sstatus = "Cannot delete ";
@@ -954,6 +958,8 @@ namespace WebUI {
                         sstatus += filename + " " + ec.message();
                     } else {
                         sstatus = filename + " renamed to " + newname;
+                        sdIndex.renamed(fpath / filename, fpath / newname);
+                        HashFS::rename_file(fpath / filename, fpath / newname);
                     }
                 }
             }
@@ -1038,15 +1044,22 @@ namespace WebUI {
                 _upload_status = UploadStatus::FAILED;
                 log_info("Upload failed - cannot create file");
                 pushError(ESP_ERROR_FILE_CREATION, "File creation failed");
+                return;
+            }
+
+            // Write in the background, hashing as the data arrives
+            if (!UploadWriter::start(_uploadFile, HashFS::file_is_hashed(fpath))) {
+                _upload_status = UploadStatus::FAILED;
+                log_info("Upload failed - no writer");
+                pushError(ESP_ERROR_FILE_CREATION, "File creation failed");
             }
         }
     }
 
     void Web_Server::uploadWrite(uint8_t* buffer, size_t length) {
-        vTaskDelay(1 / portTICK_RATE_MS);
         if (_uploadFile && _upload_status == UploadStatus::ONGOING) {
             //no error write post data
-            if (length != _uploadFile->write(buffer, length)) {
+            if (!UploadWriter::write(buffer, length)) {
                 _upload_status = UploadStatus::FAILED;
                 log_info("Upload failed - file write failed");
                 pushError(ESP_ERROR_FILE_WRITE, "File write failed");
@@ -1064,6 +1077,9 @@ namespace WebUI {
             //            delete _uploadFile;
             // _uploadFile = nullptr;
 
+            uint8_t sha[32];
+            bool    written = UploadWriter::finish(sha);
+
             std::string pathname = _uploadFile->fpath();
             delete _uploadFile;
             _uploadFile = nullptr;
@@ -1071,10 +1087,21 @@ namespace WebUI {
 
             FluidPath filepath { pathname, "" };
 
-            HashFS::rehash_file(filepath);
+            if (written) {
+                HashFS::set_hash(filepath, sha);
+            } else {
+                // Do not leave a truncated file behind
+                std::error_code error_code;
+                stdfs::remove(filepath, error_code);
+                HashFS::delete_file(filepath);
+                sdIndex.removed(filepath);
+                _upload_status = UploadStatus::FAILED;
+                log_info("Upload failed - file write failed");
+                pushError(ESP_ERROR_FILE_WRITE, "File write failed");
+            }
 
             // Check size
-            if (filesize) {
+            if (written && filesize) {
                 uint32_t actual_size;
                 try {
                     actual_size = stdfs::file_size(filepath);
@@ -1102,6 +1129,7 @@ namespace WebUI {
         _upload_status = UploadStatus::FAILED;
         log_info("Upload cancelled");
         if (_uploadFile) {
+            UploadWriter::abort();
             std::filesystem::path filepath = _uploadFile->fpath();
             delete _uploadFile;
             _uploadFile = nullptr;
@@ -1113,11 +1141,13 @@ namespace WebUI {
         if (_upload_status == UploadStatus::FAILED) {
             cancelUpload();
             if (_uploadFile) {
+                UploadWriter::abort();
                 std::filesystem::path filepath = _uploadFile->fpath();
                 delete _uploadFile;
                 _uploadFile = nullptr;
                 stdfs::remove(filepath, error_code);
                 HashFS::rehash_file(filepath);
+                sdIndex.removed(filepath);
             }
         }
     }
@@ -1137,6 +1167,7 @@ namespace WebUI {
             WSChannels::sendPing();
             start_time = millis();
         }
+        HashFS::poll();
     }
 
     void Web_Server::handle_Websocket_Event(uint8_t num, uint8_t type, uint8_t* payload, size_t length) {
@@ -15,12 +15,14 @@
 #include "../Configuration/JsonGenerator.h"
 #include "../Uart.h"       // Uart0.baud
 #include "../Report.h"     // git_info
-#include "../InputFile.h"  // InputFile
+#include "../InputFile.h"      // InputFile
+#include "../TokenizedFile.h"  // TokenizedFile
 
 #include "Commands.h"  // COMMANDS::restart_MCU();
 #include "WifiConfig.h"
 
 #include "src/HashFS.h"
+#include "src/SDIndex.h"
 
 #include <cstring>
 #include <sstream>
@@ -133,7 +135,7 @@ namespace WebUI {
                 j.end_object();
             }
 
-            entry = entry->next;
+            entry = rssReader.get_next(entry);
         }
 
         j.end_array();
@@ -329,7 +331,7 @@ namespace WebUI {
         }
 
         try {
-            theFile = new InputFile(fs, path.c_str(), auth_level, out);
+            theFile = InputFile::open(fs, path.c_str(), auth_level, out);
         } catch (Error err) { return err; }
         return Error::Ok;
     }
@@ -351,7 +353,12 @@ namespace WebUI {
             // task has a chance to forward the line to the output channel.
             // The 3-argument form works because it copies the line to a
             // temporary string.
-            log_to(out, "", fileLine);
+            if (fileLine[0] == TOKENIZED_LINE) {
+                LogStream s(out, "");
+                TokenizedFile::print_line(fileLine, s);
+            } else {
+                log_to(out, "", fileLine);
+            }
         }
         if (res != Error::Eof) {
             log_to(out, errorString(res));
@@ -392,6 +399,21 @@ namespace WebUI {
         return runFile("sd", parameter, auth_level, out);
     }
 
+    static Error tokenizeSDFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        if (notIdleOrAlarm()) {
+            return Error::IdleError;
+        }
+        if (*parameter == '\0') {
+            log_to(out, "Missing file name!");
+            return Error::InvalidValue;
+        }
+        std::string path(parameter);
+        if (path[0] != '/') {
+            path = "/" + path;
+        }
+        return TokenizedFile::convert("sd", path.c_str(), out);
+    }
+
     // Used by js/controls.js
     static Error runLocalFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {  // ESP700
         return runFile("", parameter, auth_level, out);
@@ -424,6 +446,7 @@ namespace WebUI {
             }
         }
         HashFS::delete_file(fpath);
+        sdIndex.removed(fpath);
 
         return Error::Ok;
     }
@@ -494,6 +517,8 @@ namespace WebUI {
             FluidPath inPath { ipath, fs };
             FluidPath outPath { opath, fs };
             std::filesystem::rename(inPath, outPath);
+            sdIndex.renamed(inPath, outPath);
+            HashFS::rename_file(inPath, outPath);
         } catch (const Error err) {
             log_error_to(out, "Cannot rename " << ipath << " to " << opath);
             return Error::FsFailedRenameFile;
@@ -577,8 +602,8 @@ namespace WebUI {
         return err;
     }
     static Error showLocalFSHashes(char* parameter, WebUI::AuthenticationLevel auth_level, Channel& out) {
-        for (const auto& [name, hash] : HashFS::localFsHashes) {
-            log_info_to(out, name << ": " << hash);
+        for (const auto& [name, entry] : HashFS::entries()) {
+            log_info_to(out, name << ": " << (entry.hash.length() ? entry.hash : "not yet hashed"));
         }
         return Error::Ok;
     }
@@ -734,6 +759,7 @@ namespace WebUI {
 
         new WebCommand("path", WEBCMD, WU, "ESP221", "SD/Show", showSDFile);
         new WebCommand("path", WEBCMD, WU, "ESP220", "SD/Run", runSDFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Tokenize", tokenizeSDFile);
         new WebCommand("file_or_directory_path", WEBCMD, WU, "ESP215", "SD/Delete", deleteSDObject);
         new WebCommand("path", WEBCMD, WU, NULL, "SD/Rename", renameSDObject);
         new WebCommand(NULL, WEBCMD, WU, "ESP210", "SD/List", listSDFiles);
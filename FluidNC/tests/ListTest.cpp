@@ -0,0 +1,110 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/List.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Exposes the list operations that Menu and RSSReader use
+class TestList : public List {
+public:
+    ListType list {};
+
+    TestList() { init(&list, NULL); }
+    ~TestList() { remove_entries(&list); }
+
+    using List::add_entry;
+    using List::prep;
+    using List::remove_entries;
+
+    std::vector<std::string> names() {
+        std::vector<std::string> v;
+        for (auto entry = node(&list, list.head); entry; entry = next(&list, entry)) {
+            v.push_back(entry->display_name);
+        }
+        return v;
+    }
+};
+
+TEST(List, AppendAndWalk) {
+    TestList l;
+    EXPECT_EQ(List::node(&l.list, l.list.head), nullptr);
+
+    l.prep(&l.list);
+    l.add_entry(&l.list, NULL, "/sd/a.nc", "a.nc");
+    l.add_entry(&l.list, NULL, "/sd/b.nc", "b.nc", true);
+    EXPECT_EQ(l.names(), (std::vector<std::string> { "< Back", "a.nc", "b.nc" }));
+
+    auto head = List::node(&l.list, l.list.head);
+    EXPECT_TRUE(head->selected);
+    EXPECT_EQ(List::node(&l.list, l.list.active_head), head);
+    EXPECT_EQ(List::prev(&l.list, head), nullptr);
+
+    auto tail = List::node(&l.list, l.list.tail);
+    EXPECT_STREQ(tail->path, "/sd/b.nc");
+    EXPECT_TRUE(tail->updated);
+    EXPECT_FALSE(tail->selected);
+    EXPECT_STREQ(List::prev(&l.list, tail)->display_name, "a.nc");
+    EXPECT_EQ(List::next(&l.list, tail), nullptr);
+}
+
+TEST(List, SharesAndTruncatesStrings) {
+    TestList l;
+    l.add_entry(&l.list, NULL, "/sd/jobs/part.nc", "part.nc");
+    l.add_entry(&l.list, NULL, "ERROR", "Error: Connection failed");
+    l.add_entry(&l.list, NULL, "ERROR", "Error: Connection failed");
+
+    // A file name is the tail of its path
+    auto file = List::node(&l.list, 0);
+    EXPECT_EQ(file->display_name, file->path + strlen("/sd/jobs/"));
+
+    // Repeated strings are stored once
+    EXPECT_EQ(List::node(&l.list, 1)->path, List::node(&l.list, 2)->path);
+    EXPECT_EQ(List::node(&l.list, 1)->display_name, List::node(&l.list, 2)->display_name);
+
+    std::string long_name(100, 'n');
+    std::string long_path = "/sd/" + std::string(300, 'p');
+    l.add_entry(&l.list, NULL, long_path.c_str(), long_name.c_str());
+    auto entry = List::node(&l.list, 3);
+    EXPECT_EQ(strlen(entry->display_name), size_t(LIST_NAME_MAX_STR - 1));
+    EXPECT_EQ(strlen(entry->path), size_t(LIST_NAME_MAX_PATH - 1));
+}
+
+TEST(List, GrowsAcrossBlocksAndFreesInBulk) {
+    auto before = List::stats();
+    {
+        TestList l;
+        const int n = 1000;
+        for (int i = 0; i < n; i++) {
+            std::string path = "/sd/file" + std::to_string(i) + ".nc";
+            l.add_entry(&l.list, NULL, path.c_str(), path.c_str() + 4);
+        }
+        EXPECT_EQ(l.list.count, n);
+
+        // Entries keep their addresses while the list grows
+        auto first = List::node(&l.list, 0);
+        int  i     = 0;
+        for (auto entry = first; entry; entry = List::next(&l.list, entry), i++) {
+            ASSERT_EQ(entry->display_name, "file" + std::to_string(i) + ".nc");
+        }
+        EXPECT_EQ(i, n);
+        EXPECT_EQ(List::node(&l.list, 0), first);
+
+        auto during = List::stats();
+        EXPECT_EQ(during.nodes - before.nodes, size_t(n));
+        EXPECT_LT(during.arenaBytes - before.arenaBytes, (during.legacyBytes - before.legacyBytes) / 4);
+
+        l.prep(&l.list, false);
+        EXPECT_EQ(l.list.count, 0);
+        EXPECT_EQ(List::node(&l.list, l.list.head), nullptr);
+        EXPECT_EQ(List::stats().arenaBytes, before.arenaBytes);
+
+        l.add_entry(&l.list, NULL, NULL, "Home");
+        EXPECT_TRUE(List::node(&l.list, l.list.head)->selected);
+    }
+    EXPECT_EQ(List::stats().nodes, before.nodes);
+    EXPECT_EQ(List::stats().arenaBytes, before.arenaBytes);
+}
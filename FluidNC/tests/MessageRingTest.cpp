@@ -0,0 +1,131 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/MessageRing.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static Channel* fakeChannel(int n) {
+    return reinterpret_cast<Channel*>(uintptr_t(0x1000 * (n + 1)));
+}
+
+TEST(MessageRing, EmptyRing) {
+    MessageRing ring(256);
+    Channel*    channel;
+    const char* line;
+    ASSERT_TRUE(ring.empty());
+    ASSERT_FALSE(ring.peek(channel, line));
+}
+
+TEST(MessageRing, KeepsOrderAndChannel) {
+    MessageRing ring(256);
+    ASSERT_TRUE(ring.put(fakeChannel(0), "ok", 2));
+    ASSERT_TRUE(ring.put(fakeChannel(1), "<Idle|MPos:0.000,0.000,0.000>", 29));
+
+    Channel*    channel;
+    const char* line;
+    ASSERT_TRUE(ring.peek(channel, line));
+    EXPECT_EQ(channel, fakeChannel(0));
+    EXPECT_STREQ(line, "ok");
+    ring.release();
+
+    ASSERT_TRUE(ring.peek(channel, line));
+    EXPECT_EQ(channel, fakeChannel(1));
+    EXPECT_STREQ(line, "<Idle|MPos:0.000,0.000,0.000>");
+    ring.release();
+
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(MessageRing, FullRingRejectsThenWraps) {
+    MessageRing ring(256);
+    std::string text(40, 'x');
+    int         n = 0;
+    while (ring.put(fakeChannel(0), text.c_str(), text.length())) {
+        ++n;
+    }
+    ASSERT_GT(n, 0);
+
+    Channel*    channel;
+    const char* line;
+    // Free one record; the next line must wrap past the end of the buffer
+    ASSERT_TRUE(ring.peek(channel, line));
+    ring.release();
+    ASSERT_TRUE(ring.put(fakeChannel(0), "wrapped", 7));
+
+    for (int i = 1; i < n; ++i) {
+        ASSERT_TRUE(ring.peek(channel, line));
+        EXPECT_EQ(text, line);
+        ring.release();
+    }
+    ASSERT_TRUE(ring.peek(channel, line));
+    EXPECT_STREQ(line, "wrapped");
+    ring.release();
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(MessageRing, TruncatesLongLines) {
+    MessageRing ring(256);
+    std::string text(1000, 'y');
+    ASSERT_TRUE(ring.put(fakeChannel(0), text.c_str(), text.length()));
+
+    Channel*    channel;
+    const char* line;
+    ASSERT_TRUE(ring.peek(channel, line));
+    EXPECT_EQ(strlen(line), ring.max_length());
+    ring.release();
+
+    // A maximum-length record must fit wherever the head is once the ring drains
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(ring.put(fakeChannel(0), "abc", 3));
+        ASSERT_TRUE(ring.peek(channel, line));
+        ring.release();
+        ASSERT_TRUE(ring.put(fakeChannel(0), text.c_str(), text.length()));
+        ASSERT_TRUE(ring.peek(channel, line));
+        ring.release();
+    }
+}
+
+TEST(MessageRing, ConcurrentProducers) {
+    const int   nProducers = 4;
+    const int   nLines     = 2000;
+    MessageRing ring(1024);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < nProducers; ++p) {
+        producers.emplace_back([&ring, p]() {
+            for (int i = 0; i < nLines; ++i) {
+                std::string line = std::to_string(p) + ":" + std::to_string(i);
+                while (!ring.put(fakeChannel(p), line.c_str(), line.length())) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> next(nProducers, 0);
+    int              received = 0;
+    while (received < nProducers * nLines) {
+        Channel*    channel;
+        const char* line;
+        if (!ring.peek(channel, line)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int p = atoi(line);
+        ASSERT_EQ(channel, fakeChannel(p));
+        // Lines from each producer arrive in the order they were sent
+        ASSERT_EQ(std::to_string(p) + ":" + std::to_string(next[p]), line);
+        ++next[p];
+        ++received;
+        ring.release();
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,298 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/Modbus.h"
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+using namespace Modbus;
+
+// A bus with simulated slaves on the other end.  Each slave answers a
+// request with its register value, after a delay, unless it is told to
+// stay silent, corrupt its answer or reject the request.
+class LoopbackPort : public Port {
+public:
+    struct Slave {
+        uint8_t  id         = 1;
+        uint16_t value      = 0;
+        uint32_t delay      = 0;  // Milliseconds before the response arrives
+        int      silent     = 0;  // Requests to ignore
+        int      corrupt    = 0;  // Responses to send with a bad CRC
+        bool     reject     = false;
+        bool     zeroPrefix = false;
+    };
+
+    std::vector<Slave>                slaves;
+    std::vector<std::vector<uint8_t>> sent;
+    uint32_t                          now = 0;
+
+    void send(const uint8_t* data, size_t length) override {
+        sent.emplace_back(data, data + length);
+        for (auto& s : slaves) {
+            if (s.id != data[0]) {
+                continue;
+            }
+            if (s.silent) {
+                --s.silent;
+                return;
+            }
+            std::vector<uint8_t> response;
+            if (s.zeroPrefix) {
+                response.push_back(0);
+            }
+            size_t start = response.size();
+            if (s.reject) {
+                response.insert(response.end(), { s.id, uint8_t(data[1] | 0x80), 0x02 });
+            } else {
+                response.insert(response.end(), { s.id, data[1], 0x02, uint8_t(s.value >> 8), uint8_t(s.value) });
+            }
+            uint16_t crc = crc16(response.data() + start, response.size() - start);
+            if (s.corrupt) {
+                --s.corrupt;
+                crc ^= 1;
+            }
+            response.push_back(crc & 0xff);
+            response.push_back(crc >> 8);
+            _arrival = now + s.delay;
+            _pending = response;
+        }
+    }
+
+    size_t receive(uint8_t* data, size_t length) override {
+        if (!_pending.empty() && int32_t(now - _arrival) >= 0) {
+            _input.insert(_input.end(), _pending.begin(), _pending.end());
+            _pending.clear();
+        }
+        size_t n = 0;
+        while (n < length && !_input.empty()) {
+            data[n++] = _input.front();
+            _input.pop_front();
+        }
+        return n;
+    }
+
+    void discard() override {
+        _input.clear();
+        _pending.clear();
+    }
+
+private:
+    std::deque<uint8_t>  _input;
+    std::vector<uint8_t> _pending;
+    uint32_t             _arrival = 0;
+};
+
+struct Completed {
+    uint8_t  slave;
+    Result   result;
+    uint16_t value;
+};
+static std::vector<Completed> completed;
+
+static void record(const Request& request, Result result, const uint8_t* response) {
+    uint16_t value = result == Result::Ok ? uint16_t(response[3] << 8 | response[4]) : 0;
+    completed.push_back({ request.slave(), result, value });
+}
+
+static Request readRegister(uint8_t slave, uint16_t reg, Priority priority = Priority::Poll) {
+    Request r;
+    r.priority = priority;
+    r.txLength = 6;
+    r.rxLength = 5;
+    r.msg[0]   = slave;
+    r.msg[1]   = 0x03;
+    r.msg[2]   = reg >> 8;
+    r.msg[3]   = reg & 0xff;
+    r.msg[4]   = 0x00;
+    r.msg[5]   = 0x01;
+    r.done     = record;
+    return r;
+}
+
+// Runs the master until it is idle, advancing the port's clock as it asks
+static void runUntilIdle(Master& master, LoopbackPort& port, uint32_t limit = 100000) {
+    while (!master.idle() && port.now < limit) {
+        uint32_t wait = master.service(port.now);
+        port.now += wait == UINT32_MAX ? 1 : wait;
+    }
+    master.service(port.now);
+}
+
+static uint16_t bitwiseCrc(const uint8_t* buf, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t pos = 0; pos < len; pos++) {
+        crc ^= buf[pos];
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+TEST(Modbus, CrcTable) {
+    const uint8_t frame[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x01 };
+    EXPECT_EQ(crc16(frame, sizeof(frame)), 0x0A84);
+
+    uint8_t buf[64];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = uint8_t(i * 37 + 11);
+    }
+    for (size_t len = 0; len <= sizeof(buf); len++) {
+        ASSERT_EQ(crc16(buf, len), bitwiseCrc(buf, len));
+    }
+}
+
+TEST(Modbus, ReadRegister) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 1, 0x1234, 5 });
+    Master master(port, 9600);
+
+    ASSERT_TRUE(master.submit(readRegister(1, 0x2000)));
+    runUntilIdle(master, port);
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].result, Result::Ok);
+    EXPECT_EQ(completed[0].value, 0x1234);
+    ASSERT_EQ(port.sent.size(), 1u);
+    EXPECT_EQ(port.sent[0].size(), 8u);
+    EXPECT_EQ(crc16(port.sent[0].data(), 8), 0);  // A frame with its CRC checks to zero
+    EXPECT_EQ(master._stats.transactions, 1u);
+    EXPECT_EQ(master._stats.retries, 0u);
+}
+
+TEST(Modbus, NeverBlocks) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 1, 7, 50 });
+    Master master(port, 9600);
+
+    master.submit(readRegister(1, 0));
+    EXPECT_EQ(master.service(port.now), 1u);  // Sent, waiting for the response
+    port.now += 20;
+    EXPECT_EQ(master.service(port.now), 1u);
+    EXPECT_TRUE(completed.empty());
+    port.now += 30;
+    master.service(port.now);
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].value, 7);
+}
+
+TEST(Modbus, SetpointPreemptsPolls) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 1, 0, 2 });
+    Master master(port, 9600);
+
+    master.submit(readRegister(1, 0x10));
+    master.service(port.now);  // The first poll is now on the bus
+    master.submit(readRegister(1, 0x11));
+    master.submit(readRegister(1, 0x12));
+    master.submit(readRegister(1, 0x99, Priority::Setpoint));
+    runUntilIdle(master, port);
+
+    ASSERT_EQ(port.sent.size(), 4u);
+    EXPECT_EQ(port.sent[0][3], 0x10);
+    EXPECT_EQ(port.sent[1][3], 0x99);
+    EXPECT_EQ(port.sent[2][3], 0x11);
+    EXPECT_EQ(port.sent[3][3], 0x12);
+}
+
+TEST(Modbus, RetriesThenFails) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 1 });
+    port.slaves[0].silent = 100;
+    Master master(port, 9600);
+    master._timeoutMs = 100;
+
+    master.submit(readRegister(1, 0));
+    runUntilIdle(master, port);
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].result, Result::Failed);
+    EXPECT_EQ(int(port.sent.size()), master._maxRetries);
+    EXPECT_EQ(int(master._stats.timeouts), master._maxRetries);
+    EXPECT_EQ(master._stats.failures, 1u);
+    EXPECT_LT(port.now, 1000u);  // No fixed sleeps between attempts
+}
+
+TEST(Modbus, BadCrcIsRetried) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 1, 42 });
+    port.slaves[0].corrupt = 2;
+    Master master(port, 9600);
+
+    master.submit(readRegister(1, 0));
+    runUntilIdle(master, port);
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].result, Result::Ok);
+    EXPECT_EQ(completed[0].value, 42);
+    EXPECT_EQ(master._stats.badFrames, 2u);
+    EXPECT_EQ(master._stats.retries, 2u);
+}
+
+TEST(Modbus, ExceptionCompletesAtOnce) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 1 });
+    port.slaves[0].reject = true;
+    Master master(port, 9600);
+
+    master.submit(readRegister(1, 0));
+    runUntilIdle(master, port);
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].result, Result::Exception);
+    EXPECT_EQ(port.sent.size(), 1u);
+    EXPECT_LT(port.now, 100u);
+}
+
+TEST(Modbus, SkipsLeadingZero) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 3, 0xBEEF });
+    port.slaves[0].zeroPrefix = true;
+    Master master(port, 9600);
+
+    master.submit(readRegister(3, 0));
+    runUntilIdle(master, port);
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].result, Result::Ok);
+    EXPECT_EQ(completed[0].value, 0xBEEF);
+}
+
+TEST(Modbus, SeveralSlaves) {
+    completed.clear();
+    LoopbackPort port;
+    port.slaves.push_back({ 1, 100, 3 });
+    port.slaves.push_back({ 2, 200, 1 });
+    Master master(port, 19200);
+
+    master.submit(readRegister(1, 0));
+    master.submit(readRegister(2, 0));
+    master.submit(readRegister(1, 0));
+    runUntilIdle(master, port);
+
+    ASSERT_EQ(completed.size(), 3u);
+    EXPECT_EQ(completed[0].slave, 1);
+    EXPECT_EQ(completed[0].value, 100);
+    EXPECT_EQ(completed[1].slave, 2);
+    EXPECT_EQ(completed[1].value, 200);
+    EXPECT_EQ(completed[2].slave, 1);
+}
+
+TEST(Modbus, QueueFull) {
+    LoopbackPort port;
+    Master       master(port, 9600);
+    for (int i = 0; i < Master::queueSize; i++) {
+        ASSERT_TRUE(master.submit(readRegister(1, 0)));
+    }
+    EXPECT_FALSE(master.submit(readRegister(1, 0)));
+}
@@ -0,0 +1,372 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Throughput of the planner -> segment pipeline on the host.  Moves are fed through
+// plan_buffer_line() and Stepper::prep_buffer() as mc_move_motors() would, with the
+// stepper ISR replaced by Stepper::simulate_segment().  Only Planner, Stepper, Raster
+// and Spindle are the real sources; the rest of the machine is stubbed below.
+
+#include "gtest/gtest.h"
+#include "src/Machine/MachineConfig.h"
+#include "src/Planner.h"
+#include "src/Stepper.h"
+#include "src/StepTrace.h"
+#include "src/MotionControl.h"  // probeState
+#include "src/Logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+    const int   nAxis        = 3;
+    const float stepsPerMm   = 80.0f;
+    const float maxRate      = 5000.0f;  // mm/min
+    const float acceleration = 500.0f;   // mm/sec^2
+
+    using Clock = std::chrono::steady_clock;
+
+    // Call latencies in power-of-two nanosecond buckets
+    class Histogram {
+    public:
+        static const int nBuckets = 20;  // <1ns, <2ns, <4ns ... >=256us
+
+        const char* _name;
+        uint32_t    _buckets[nBuckets] = {};
+        uint32_t    _count             = 0;
+        uint64_t    _totalNs           = 0;
+        uint64_t    _maxNs             = 0;
+
+        Histogram(const char* name) : _name(name) {}
+
+        void add(Clock::duration d) {
+            uint64_t ns     = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+            int      bucket = 0;
+            for (uint64_t n = ns; n && bucket < (nBuckets - 1); n >>= 1) {
+                ++bucket;
+            }
+            ++_buckets[bucket];
+            ++_count;
+            _totalNs += ns;
+            _maxNs = std::max(_maxNs, ns);
+        }
+
+        void report() const {
+            if (!_count) {
+                return;
+            }
+            printf("[ Pipeline ] %-16s n=%u mean=%.0fns max=%lluns\n",
+                   _name,
+                   _count,
+                   double(_totalNs) / _count,
+                   (unsigned long long)_maxNs);
+            printf("[ Pipeline ] %-16s", _name);
+            for (int i = 0; i < nBuckets; i++) {
+                if (_buckets[i]) {
+                    printf(" <%lluns:%u", 1ULL << i, _buckets[i]);
+                }
+            }
+            printf("\n");
+        }
+    };
+
+    class StdoutPrint : public Print {
+    public:
+        size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    };
+
+    // A spindle with no speed map, so the segment generator's spindle paths do no work
+    class NullSpindle : public Spindles::Spindle {
+    public:
+        void        init() override {}
+        void        setState(SpindleState state, uint32_t speed) override {}
+        void        config_message() override {}
+        void        setSpeedfromISR(uint32_t dev_speed) override {}
+        const char* name() const override { return "NullSpindle"; }
+    };
+
+    class PipelineBench : public ::testing::Test {
+    protected:
+        Histogram planHist { "plan_buffer_line" };
+        Histogram prepHist { "prep_buffer" };
+        Histogram isrHist { "segment" };
+
+        uint32_t nBlocks   = 0;
+        uint32_t nSegments = 0;
+        uint64_t nTicks    = 0;
+
+        void SetUp() override {
+            config                     = new Machine::MachineConfig();
+            config->_axes              = new Machine::Axes();
+            config->_axes->_numberAxis = nAxis;
+            config->_stepping          = new Machine::Stepping();
+            spindle                    = new NullSpindle();
+            sys                        = {};
+            sys.f_override             = FeedOverride::Default;
+            sys.r_override             = RapidOverride::Default;
+            sys.spindle_speed_ovr      = SpindleSpeedOverride::Default;
+            sys.step_control.endMotion = false;
+            probeState                 = ProbeState::Off;
+
+            plan_init();
+            Stepper::init();
+            Stepper::reset();
+            plan_reset();
+            plan_sync_position();
+            plan_reset_stats();
+        }
+
+        void TearDown() override {
+            delete spindle;
+            delete config->_stepping;
+            delete config->_axes;
+            delete config;
+            spindle = nullptr;
+            config  = nullptr;
+        }
+
+        // Stands in for the stepper ISR: fill the segment buffer, then consume it
+        bool cycle() {
+            auto start = Clock::now();
+            Stepper::prep_buffer();
+            prepHist.add(Clock::now() - start);
+
+            bool any = false;
+            while (true) {
+                start          = Clock::now();
+                uint32_t ticks = Stepper::simulate_segment();
+                if (!ticks) {
+                    break;
+                }
+                isrHist.add(Clock::now() - start);
+                nTicks += ticks;
+                ++nSegments;
+                any = true;
+            }
+            return any;
+        }
+
+        // mc_move_motors() without the realtime checks
+        void move(float* target, plan_line_data_t* pl_data) {
+            while (plan_check_full_buffer()) {
+                if (!cycle()) {
+                    break;
+                }
+            }
+            auto start = Clock::now();
+            if (plan_buffer_line(target, pl_data)) {
+                ++nBlocks;
+            }
+            planHist.add(Clock::now() - start);
+        }
+
+        // protocol_buffer_synchronize() with simulated stepping
+        void drain() {
+            while (plan_get_current_block()) {
+                if (!cycle()) {
+                    break;
+                }
+            }
+        }
+
+        void report(const char* job, uint32_t nLines, Clock::duration elapsed) {
+            double seconds = std::chrono::duration<double>(elapsed).count();
+            printf("[ Pipeline ] %s: lines=%u blocks=%u segments=%u ticks=%llu time=%.1fms\n",
+                   job,
+                   nLines,
+                   nBlocks,
+                   nSegments,
+                   (unsigned long long)nTicks,
+                   seconds * 1000);
+            printf("[ Pipeline ] lines/s=%.0f blocks/s=%.0f segments/s=%.0f\n",
+                   nLines / seconds,
+                   nBlocks / seconds,
+                   nSegments / seconds);
+            printf("[ Pipeline ] planner depth=%d block=%dB profile=%dB ",
+                   int(config->_planner_blocks),
+                   int(sizeof(plan_block_t)),
+                   int(sizeof(plan_profile_t)));
+            StdoutPrint out;
+            plan_report_stats(out);
+            printf("\n");
+            planHist.report();
+            prepHist.report();
+            isrHist.report();
+        }
+    };
+}
+
+// Short chords around a circle, as CAM output for curved toolpaths
+TEST_F(PipelineBench, Chords) {
+    plan_line_data_t pl_data = {};
+    pl_data.feed_rate        = 3000.0f;
+    pl_data.spindle          = SpindleState::Disable;
+
+    const uint32_t nLines             = 20000;
+    const float    radius             = 20.0f;
+    float          target[MAX_N_AXIS] = {};
+
+    auto start = Clock::now();
+    for (uint32_t i = 1; i <= nLines; i++) {
+        float angle = float(i) * 0.01f;  // 0.2mm chords
+        target[0]   = radius * cosf(angle) - radius;
+        target[1]   = radius * sinf(angle);
+        move(target, &pl_data);
+    }
+    drain();
+    report("chords", nLines, Clock::now() - start);
+
+    EXPECT_EQ(nBlocks, nLines);
+    EXPECT_TRUE(plan_buffer_empty());
+    EXPECT_EQ(Stepper::simulate_segment(), 0u);
+    EXPECT_GT(nSegments, nBlocks);
+}
+
+// Long straight moves alternating with rapids, where segment preparation dominates
+TEST_F(PipelineBench, Lines) {
+    plan_line_data_t pl_data = {};
+    pl_data.feed_rate        = 3000.0f;
+    pl_data.spindle          = SpindleState::Disable;
+
+    const uint32_t nLines             = 400;
+    float          target[MAX_N_AXIS] = {};
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < nLines; i++) {
+        pl_data.motion.rapidMotion = (i & 2) != 0;
+        target[0]                  = (i & 1) ? 0.0f : 100.0f;
+        target[1]                  = float(i / 2);
+        move(target, &pl_data);
+    }
+    drain();
+    report("lines", nLines, Clock::now() - start);
+
+    EXPECT_EQ(nBlocks, nLines);
+    EXPECT_TRUE(plan_buffer_empty());
+    EXPECT_EQ(Stepper::simulate_segment(), 0u);
+}
+
+// Link seams for the parts of the firmware that the pipeline calls but that
+// cannot run on the host.  Axis limits come from the constants above.
+
+Machine::MachineConfig* config = nullptr;
+system_t                sys;
+int32_t                 probe_steps[MAX_N_AXIS];
+volatile ProbeState     probeState;
+
+NoArgEvent cycleStopEvent { nullptr };
+NoArgEvent motionCancelEvent { nullptr };
+
+namespace Machine {
+    MachineConfig::~MachineConfig() {}
+    void MachineConfig::group(Configuration::HandlerBase& handler) {}
+    void MachineConfig::afterParse() {}
+
+    Axes::Axes() {
+        for (int i = 0; i < MAX_N_AXIS; i++) {
+            _axis[i] = nullptr;
+        }
+    }
+    Axes::~Axes() {}
+    void Axes::group(Configuration::HandlerBase& handler) {}
+    void Axes::afterParse() {}
+    void Axes::set_disable(bool disable) {}
+    void Axes::step(uint8_t step_mask, uint8_t dir_mask) {}
+    void Axes::unstep() {}
+
+    Axis::~Axis() {}
+    void Axis::group(Configuration::HandlerBase& handler) {}
+    void Axis::afterParse() {}
+
+    Motor::~Motor() {}
+    void Motor::group(Configuration::HandlerBase& handler) {}
+    void Motor::afterParse() {}
+
+    int  Stepping::_engine = 0;
+    void Stepping::group(Configuration::HandlerBase& handler) {}
+    void Stepping::afterParse() {}
+    void Stepping::reset() {}
+    void Stepping::setTimerPeriod(uint16_t timerTicks) {}
+    void Stepping::startTimer() {}
+}
+
+Pins::PinDetail* Pin::undefinedPin = nullptr;
+Pin::~Pin() {}
+
+void Probe::validate() {}
+void Probe::group(Configuration::HandlerBase& handler) {}
+bool Probe::tripped() {
+    return false;
+}
+
+namespace StepTrace {
+    std::atomic<bool> enabled { false };
+    void              on_pulse() {}
+    void              on_segment(uint16_t period) {}
+    void              on_stop(bool underrun) {}
+}
+
+float steps_to_mpos(int32_t steps, size_t axis) {
+    return steps / stepsPerMm;
+}
+int32_t mpos_to_steps(float mpos, size_t axis) {
+    return lroundf(mpos * stepsPerMm);
+}
+int32_t* get_motor_steps() {
+    static int32_t motor_steps[MAX_N_AXIS];
+    return motor_steps;
+}
+
+float convert_delta_vector_to_unit_vector(float* v) {
+    float magnitude = 0;
+    for (int i = 0; i < nAxis; i++) {
+        magnitude += v[i] * v[i];
+    }
+    magnitude = sqrtf(magnitude);
+    for (int i = 0; i < nAxis; i++) {
+        v[i] /= magnitude;
+    }
+    return magnitude;
+}
+float limit_acceleration_by_axis_maximum(float* unit_vec, bool is_rapid) {
+    float limit = SOME_LARGE_VALUE;
+    for (int i = 0; i < nAxis; i++) {
+        if (unit_vec[i] != 0) {
+            limit = std::min(limit, fabsf(acceleration / unit_vec[i]));
+        }
+    }
+    return limit * 60.0f * 60.0f;
+}
+float limit_rate_by_axis_maximum(float* unit_vec) {
+    float limit = SOME_LARGE_VALUE;
+    for (int i = 0; i < nAxis; i++) {
+        if (unit_vec[i] != 0) {
+            limit = std::min(limit, fabsf(maxRate / unit_vec[i]));
+        }
+    }
+    return limit;
+}
+
+void protocol_disable_steppers() {}
+void protocol_cancel_disable_steppers() {}
+void protocol_send_event_from_ISR(Event* evt, void* arg) {}
+
+void delay(uint32_t ms) {}
+void DumpStackTrace(std::ostringstream& builder) {}
+
+// Log output is dropped; nothing in the pipeline logs unless it is misconfigured
+bool atMsgLevel(MsgLevel level) {
+    return false;
+}
+alignas(Channel) static char noChannel[sizeof(Channel)];
+LogStream::LogStream(Channel& channel, const char* name) : _channel(channel) {}
+LogStream::LogStream(const char* name) : LogStream(*reinterpret_cast<Channel*>(noChannel), name) {}
+size_t LogStream::write(uint8_t c) {
+    return 1;
+}
+size_t LogStream::write(const uint8_t* buffer, size_t length) {
+    return length;
+}
+LogStream::~LogStream() {}
@@ -0,0 +1,116 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/SDIndex.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// A scratch directory that stands in for the card
+class SDIndexTest : public ::testing::Test {
+protected:
+    fs::path root;
+
+    void SetUp() override {
+        root = fs::temp_directory_path() / ("sdindex_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+        fs::remove_all(root);
+        fs::create_directories(root);
+    }
+    void TearDown() override { fs::remove_all(root); }
+
+    void touch(const std::string& rel) {
+        fs::path p = root / rel.substr(1);
+        fs::create_directories(p.parent_path());
+        std::ofstream(p) << "G0 X0\n";
+    }
+
+    static std::vector<std::string> entries(SDIndex& index) {
+        std::vector<std::string> v;
+        std::string              s;
+        for (size_t i = 0; index.get(i, s); i++) {
+            v.push_back(s);
+        }
+        return v;
+    }
+};
+
+TEST_F(SDIndexTest, RebuildFindsJobFiles) {
+    touch("/b.nc");
+    touch("/a.GCODE");
+    touch("/notes.txt");
+    touch("/image.png");
+    touch("/jobs/deep/c.nc");
+
+    SDIndex index(root.c_str());
+    EXPECT_FALSE(index.valid());
+    index.rebuild();
+    EXPECT_TRUE(index.valid());
+    EXPECT_EQ(entries(index), (std::vector<std::string> { "/a.GCODE", "/b.nc", "/jobs/deep/c.nc", "/notes.txt" }));
+}
+
+TEST_F(SDIndexTest, IncrementalUpdates) {
+    touch("/a.nc");
+    SDIndex index(root.c_str());
+    index.rebuild();
+    uint32_t gen   = index.generation();
+    uint32_t scans = index._scans;
+
+    touch("/z.nc");
+    index.added(root / "z.nc");
+    EXPECT_NE(index.generation(), gen);
+    EXPECT_EQ(entries(index), (std::vector<std::string> { "/a.nc", "/z.nc" }));
+
+    // Rewriting a file that is already listed changes nothing
+    gen = index.generation();
+    index.added(root / "z.nc");
+    index.added(root / "readme.md");
+    EXPECT_EQ(index.generation(), gen);
+
+    index.removed(root / "a.nc");
+    EXPECT_EQ(entries(index), (std::vector<std::string> { "/z.nc" }));
+
+    fs::rename(root / "z.nc", root / "y.nc");
+    index.renamed(root / "z.nc", root / "y.nc");
+    EXPECT_EQ(entries(index), (std::vector<std::string> { "/y.nc" }));
+
+    EXPECT_EQ(index._scans, scans);  // None of that walked the card
+}
+
+TEST_F(SDIndexTest, Directories) {
+    touch("/a/1.nc");
+    touch("/a/2.nc");
+    touch("/ab.nc");
+    touch("/ab/3.nc");
+    SDIndex index(root.c_str());
+    index.rebuild();
+
+    index.removed(root / "a");
+    EXPECT_EQ(entries(index), (std::vector<std::string> { "/ab.nc", "/ab/3.nc" }));
+
+    touch("/c/d/4.nc");
+    index.added(root / "c");
+    EXPECT_EQ(entries(index), (std::vector<std::string> { "/ab.nc", "/ab/3.nc", "/c/d/4.nc" }));
+
+    index.removed(root);
+    EXPECT_TRUE(entries(index).empty());
+}
+
+TEST_F(SDIndexTest, IgnoresOtherPaths) {
+    SDIndex index(root.c_str());
+    index.added(root / "early.nc");  // Not built yet
+    index.rebuild();
+    EXPECT_EQ(index.size(), 0u);
+
+    uint32_t gen = index.generation();
+    index.added("/littlefs/config.nc");
+    index.added(root.string() + "x/y.nc");  // Shares the root's name as a prefix
+    EXPECT_EQ(index.generation(), gen);
+    EXPECT_EQ(index.size(), 0u);
+
+    index.clear();
+    EXPECT_FALSE(index.valid());
+}
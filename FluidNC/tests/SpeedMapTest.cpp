@@ -0,0 +1,105 @@
+// Copyright (c) 2023 Bantam Tools
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/Spindles/SpeedMap.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Same arithmetic as Spindle::setupSpeeds()
+static std::vector<SpeedMap::Segment> makeMap(const std::vector<std::pair<uint32_t, float>>& points, uint32_t max_dev_speed) {
+    std::vector<SpeedMap::Segment> map;
+    size_t                         n = points.size();
+    for (size_t i = 0; i < n; i++) {
+        uint32_t offset = uint32_t(points[i].second / 100.0 * max_dev_speed);
+        uint32_t scale  = 0;
+        if (i + 1 < n) {
+            float deltaPercent = (points[i + 1].second - points[i].second) / 100.0f;
+            float deltaRPM     = float(points[i + 1].first) - float(points[i].first);
+            scale              = uint32_t((deltaRPM == 0.0f ? 0.0f : deltaPercent / deltaRPM) * max_dev_speed * 65536);
+        }
+        map.push_back({ points[i].first, offset, scale });
+    }
+    return map;
+}
+
+// Maps of 2 to 10 entries, like those in typical machine configs
+static std::vector<std::vector<SpeedMap::Segment>> typicalMaps() {
+    std::vector<std::vector<SpeedMap::Segment>> maps;
+    maps.push_back(makeMap({ { 0, 0.0f }, { 1000, 100.0f } }, 1023));                                // Laser
+    maps.push_back(makeMap({ { 0, 0.0f }, { 0, 25.0f }, { 6000, 25.0f }, { 24000, 100.0f } }, 4095));  // Shelf
+    for (int n = 5; n <= 10; n++) {
+        std::vector<std::pair<uint32_t, float>> points;
+        for (int i = 0; i < n; i++) {
+            points.push_back({ uint32_t(i * i * 30000 / ((n - 1) * (n - 1))), 100.0f * i / (n - 1) });
+        }
+        maps.push_back(makeMap(points, 65535));
+    }
+    return maps;
+}
+
+TEST(SpeedMap, MatchesScan) {
+    for (auto& segments : typicalMaps()) {
+        SpeedMap map;
+        map.build(segments);
+        uint32_t top = segments.back().speed;
+        for (uint32_t speed = 0; speed <= top + 100; speed++) {
+            ASSERT_EQ(map.lookup(speed), SpeedMap::scan(segments.data(), segments.size(), speed)) << "speed " << speed;
+        }
+    }
+}
+
+TEST(SpeedMap, BelowFirstBreakpoint) {
+    std::vector<SpeedMap::Segment> segments = makeMap({ { 500, 10.0f }, { 1000, 50.0f }, { 2000, 100.0f } }, 1000);
+    SpeedMap                       map;
+    map.build(segments);
+    EXPECT_EQ(map.lookup(0), segments[0].offset);
+    EXPECT_EQ(map.lookup(499), segments[0].offset);
+    EXPECT_EQ(map.lookup(2000), segments[2].offset);
+    EXPECT_EQ(map.lookup(0xffffffff), segments[2].offset);
+}
+
+TEST(SpeedMap, UnsortedFallsBackToScan) {
+    std::vector<SpeedMap::Segment> segments = { { 0, 0, 100 }, { 2000, 50, 200 }, { 1000, 80, 0 } };
+    SpeedMap                       map;
+    map.build(segments);
+    for (uint32_t speed = 0; speed < 3000; speed += 7) {
+        ASSERT_EQ(map.lookup(speed), SpeedMap::scan(segments.data(), segments.size(), speed));
+    }
+}
+
+TEST(SpeedMap, EmptyAndSingle) {
+    SpeedMap map;
+    EXPECT_EQ(map.lookup(100), 0u);
+    std::vector<SpeedMap::Segment> one = { { 0, 42, 0 } };
+    map.build(one);
+    EXPECT_EQ(map.lookup(100), 42u);
+}
+
+// Not a pass/fail test; prints the time per lookup for each map size
+TEST(SpeedMap, Benchmark) {
+    using clock          = std::chrono::steady_clock;
+    const int iterations = 2000000;
+
+    for (auto& segments : typicalMaps()) {
+        SpeedMap map;
+        map.build(segments);
+        uint32_t top = segments.back().speed + 1;
+
+        volatile uint32_t sink  = 0;
+        auto              start = clock::now();
+        for (int i = 0; i < iterations; i++) {
+            sink = sink + SpeedMap::scan(segments.data(), segments.size(), uint32_t(i * 7919u) % top);
+        }
+        auto mid = clock::now();
+        for (int i = 0; i < iterations; i++) {
+            sink = sink + map.lookup(uint32_t(i * 7919u) % top);
+        }
+        auto   end    = clock::now();
+        double scanNs = std::chrono::duration<double, std::nano>(mid - start).count() / iterations;
+        double lutNs  = std::chrono::duration<double, std::nano>(end - mid).count() / iterations;
+        printf("[ SpeedMap ] %2zu entries: scan %.2f ns, lookup %.2f ns\n", segments.size(), scanNs, lutNs);
+    }
+}
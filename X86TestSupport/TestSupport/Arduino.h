@@ -7,6 +7,7 @@
 class SystemRestartException {};
 
 #define IRAM_ATTR
+#define PROGMEM
 
 // From Arduino.h:
 
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// Only what the FluidNC headers need; the display itself is never drawn on X86
+
+enum OLEDDISPLAY_GEOMETRY { GEOMETRY_128_64, GEOMETRY_128_32, GEOMETRY_64_48, GEOMETRY_64_32, GEOMETRY_RAWMODE };
+enum OLEDDISPLAY_TEXT_ALIGNMENT { TEXT_ALIGN_LEFT, TEXT_ALIGN_RIGHT, TEXT_ALIGN_CENTER, TEXT_ALIGN_CENTER_BOTH };
+enum OLEDDISPLAY_COLOR { BLACK, WHITE, INVERSE };
+
+#define COLUMNADDR 0x21
+#define PAGEADDR 0x22
+
+class OLEDDisplay {
+protected:
+    OLEDDISPLAY_GEOMETRY geometry          = GEOMETRY_128_64;
+    uint8_t*             buffer            = nullptr;
+    uint16_t             displayBufferSize = 0;
+
+public:
+    virtual ~OLEDDisplay() {}
+
+    void     setGeometry(OLEDDISPLAY_GEOMETRY g) { geometry = g; }
+    uint16_t width() { return 128; }
+    uint16_t height() { return 64; }
+
+    virtual void display() = 0;
+};
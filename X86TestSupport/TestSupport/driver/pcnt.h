@@ -0,0 +1,3 @@
+#pragma once
+
+typedef int pcnt_unit_t;
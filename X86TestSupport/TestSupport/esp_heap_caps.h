@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+// The host has a single heap, so the capabilities are ignored
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+inline void heap_caps_free(void* ptr) {
+    free(ptr);
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "Arduino.h"  // esp_timer_get_time()
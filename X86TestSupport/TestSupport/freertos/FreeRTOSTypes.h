@@ -3,6 +3,7 @@
 #include <mutex>
 
 #define portMAX_DELAY (TickType_t)0xffffffffUL
+#define configMAX_PRIORITIES 25
 
 using portBASE_TYPE = int;
 using UBaseType_t   = unsigned int;
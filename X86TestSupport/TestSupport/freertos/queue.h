@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Task.h"
+#include "task.h"
 #include "FreeRTOSTypes.h"
 
 #include <queue>
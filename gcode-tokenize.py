@@ -0,0 +1,134 @@
+#!/usr/bin/env python
+
+# Convert GCode files to the pre-tokenized .gct format that FluidNC can run
+# without re-parsing the text; see FluidNC/src/TokenizedFile.h for the layout.
+# The output is the same as that of the $SD/Tokenize command.
+#
+# Usage: gcode-tokenize.py file.nc [file2.nc ...]
+
+import struct, sys, os
+
+MAGIC = b'FNCT'
+VERSION = 1
+TEXT_RECORD = 0xff
+MAX_LINE = 255
+WORD_SIZE = 5
+MAX_WORDS = (MAX_LINE - 2) // WORD_SIZE
+MAX_INT_DIGITS = 8
+
+def f32(x):
+    return struct.unpack('<f', struct.pack('<f', x))[0]
+
+def collapse(line):
+    # Mirrors collapseGCode() in GCode.cpp
+    out = []
+    in_comment = False
+    for c in line:
+        if c.isspace():
+            continue
+        if c == ')':
+            in_comment = False
+        elif c == '(':
+            in_comment = True
+        elif c == ';':
+            break
+        elif c in '%\r':
+            pass
+        elif not in_comment:
+            out.append(c.upper())
+    return ''.join(out)
+
+def read_float(line, pos):
+    # Mirrors read_float() in NutsBolts.cpp, including its float rounding.
+    # Returns (value, next position) or None.
+    negative = False
+    if pos < len(line) and line[pos] in '+-':
+        negative = line[pos] == '-'
+        pos += 1
+    intval = 0
+    exp = 0
+    ndigit = 0
+    decimal = False
+    while pos < len(line):
+        c = line[pos]
+        if c.isdigit():
+            ndigit += 1
+            if ndigit <= MAX_INT_DIGITS:
+                if decimal:
+                    exp -= 1
+                intval = intval * 10 + int(c)
+            elif not decimal:
+                exp += 1
+        elif c == '.' and not decimal:
+            decimal = True
+        else:
+            break
+        pos += 1
+    if not ndigit:
+        return None
+    fval = f32(intval)
+    if fval != 0:
+        while exp <= -2:
+            fval = f32(fval * f32(0.01))
+            exp += 2
+        if exp < 0:
+            fval = f32(fval * f32(0.1))
+        elif exp > 0:
+            while exp > 0:
+                fval = f32(fval * 10.0)
+                exp -= 1
+    return (-fval if negative else fval, pos)
+
+def tokenize(line):
+    words = []
+    pos = 0
+    while pos < len(line):
+        letter = line[pos]
+        pos += 1
+        if not ('A' <= letter <= 'Z') or len(words) == MAX_WORDS:
+            return None
+        result = read_float(line, pos)
+        if result is None:
+            return None
+        value, pos = result
+        words.append((letter, value))
+    return words
+
+def text_record(line_num, text):
+    data = text.encode('latin-1')
+    return struct.pack('<IBB', line_num, TEXT_RECORD, len(data)) + data
+
+def convert(src):
+    dst = os.path.splitext(src)[0] + '.gct'
+    blocks = texts = lines = 0
+    with open(src, 'r', encoding='latin-1', newline='') as f:
+        out = bytearray(MAGIC + bytes([VERSION, 0, 0, 0]))
+        for lines, line in enumerate(f.read().split('\n'), 1):
+            line = line.replace('\r', '')
+            if len(line) >= MAX_LINE - 1:
+                sys.exit('%s:%d: line too long' % (src, lines))
+            if line.startswith('$') or line.startswith('[') or ('(' in line and 'MSG' in line):
+                out += text_record(lines, line)
+                texts += 1
+                continue
+            collapsed = collapse(line)
+            if not collapsed:
+                continue
+            words = tokenize(collapsed)
+            if words is None:
+                out += text_record(lines, line)
+                texts += 1
+                continue
+            out += struct.pack('<IB', lines, len(words))
+            for letter, value in words:
+                out += struct.pack('<Bf', ord(letter), value)
+            blocks += 1
+    with open(dst, 'wb') as f:
+        f.write(out)
+    print('%s: %d blocks, %d text lines -> %s' % (src, blocks, texts, dst))
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        sys.exit('Usage: gcode-tokenize.py file.nc [file2.nc ...]')
+    for path in sys.argv[1:]:
+        convert(path)